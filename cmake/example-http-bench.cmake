@@ -0,0 +1,35 @@
+add_executable(cotask-example-http-bench "")
+
+set_property(TARGET cotask-example-http-bench PROPERTY EXCLUDE_FROM_ALL true)
+set_property(TARGET cotask-example-http-bench PROPERTY CXX_STANDARD 20)
+use_sanitizer(cotask-example-http-bench)
+
+target_sources(
+  cotask-example-http-bench
+  PRIVATE
+    example/http_bench.cpp
+)
+
+if (CMAKE_CXX_COMPILER_ID MATCHES "Clang|GNU")
+  target_compile_options(
+    cotask-example-http-bench
+    PRIVATE
+      -Wall
+      -Wextra
+  )
+endif()
+
+if (CMAKE_CXX_COMPILER_ID MATCHES "MSVC")
+  target_compile_options(
+    cotask-example-http-bench
+    PRIVATE
+      /W3
+      /sdl
+  )
+endif()
+
+target_link_libraries(
+  cotask-example-http-bench
+  PRIVATE
+    cotask
+)
@@ -0,0 +1,35 @@
+add_executable(cotask-example-http-server "")
+
+set_property(TARGET cotask-example-http-server PROPERTY EXCLUDE_FROM_ALL true)
+set_property(TARGET cotask-example-http-server PROPERTY CXX_STANDARD 20)
+use_sanitizer(cotask-example-http-server)
+
+target_sources(
+  cotask-example-http-server
+  PRIVATE
+    example/http_server.cpp
+)
+
+if (CMAKE_CXX_COMPILER_ID MATCHES "Clang|GNU")
+  target_compile_options(
+    cotask-example-http-server
+    PRIVATE
+      -Wall
+      -Wextra
+  )
+endif()
+
+if (CMAKE_CXX_COMPILER_ID MATCHES "MSVC")
+  target_compile_options(
+    cotask-example-http-server
+    PRIVATE
+      /W3
+      /sdl
+  )
+endif()
+
+target_link_libraries(
+  cotask-example-http-server
+  PRIVATE
+    cotask
+)
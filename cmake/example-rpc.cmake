@@ -0,0 +1,35 @@
+add_executable(cotask-example-rpc "")
+
+set_property(TARGET cotask-example-rpc PROPERTY EXCLUDE_FROM_ALL true)
+set_property(TARGET cotask-example-rpc PROPERTY CXX_STANDARD 20)
+use_sanitizer(cotask-example-rpc)
+
+target_sources(
+  cotask-example-rpc
+  PRIVATE
+    example/rpc.cpp
+)
+
+if (CMAKE_CXX_COMPILER_ID MATCHES "Clang|GNU")
+  target_compile_options(
+    cotask-example-rpc
+    PRIVATE
+      -Wall
+      -Wextra
+  )
+endif()
+
+if (CMAKE_CXX_COMPILER_ID MATCHES "MSVC")
+  target_compile_options(
+    cotask-example-rpc
+    PRIVATE
+      /W3
+      /sdl
+  )
+endif()
+
+target_link_libraries(
+  cotask-example-rpc
+  PRIVATE
+    cotask
+)
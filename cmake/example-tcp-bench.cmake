@@ -0,0 +1,35 @@
+add_executable(cotask-example-tcp-bench "")
+
+set_property(TARGET cotask-example-tcp-bench PROPERTY EXCLUDE_FROM_ALL true)
+set_property(TARGET cotask-example-tcp-bench PROPERTY CXX_STANDARD 20)
+use_sanitizer(cotask-example-tcp-bench)
+
+target_sources(
+  cotask-example-tcp-bench
+  PRIVATE
+    example/tcp_bench.cpp
+)
+
+if (CMAKE_CXX_COMPILER_ID MATCHES "Clang|GNU")
+  target_compile_options(
+    cotask-example-tcp-bench
+    PRIVATE
+      -Wall
+      -Wextra
+  )
+endif()
+
+if (CMAKE_CXX_COMPILER_ID MATCHES "MSVC")
+  target_compile_options(
+    cotask-example-tcp-bench
+    PRIVATE
+      /W3
+      /sdl
+  )
+endif()
+
+target_link_libraries(
+  cotask-example-tcp-bench
+  PRIVATE
+    cotask
+)
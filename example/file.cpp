@@ -1,9 +1,12 @@
 #include <cstdlib>
 #include <array>
 #include <format>
+#include <vector>
 #include <iostream>
 
 #include <cotask/file.hpp>
+#include <cotask/fs.hpp>
+#include <cotask/durable_log.hpp>
 
 auto async_fn0(cotask::TaskScheduler &) -> cotask::Task<void> {
   std::cout << "async_fn0 - start\n";
@@ -52,10 +55,81 @@ auto async_fn2(cotask::TaskScheduler &ts) -> cotask::Task<void> {
   co_return;
 };
 
+auto async_fn3(cotask::TaskScheduler &) -> cotask::Task<void> {
+  std::cout << "async_fn3 - start\n";
+
+  auto mapped = cotask::MappedFile{"src/cotask/utils.hpp", 0, 0, cotask::FileAccessHint::Sequential};
+  if (mapped.is_open()) {
+    auto head = mapped.read(0, 14);
+    std::cout << std::format("async_fn3 - mapped head:\n{}\n", std::string_view{head.data(), head.size()});
+    std::cout << std::format("async_fn3 - mapped size: {}\n", mapped.data().size());
+  }
+  mapped.close();
+
+  std::cout << "async_fn3 - done\n";
+  co_return;
+};
+
+auto async_fn4(cotask::TaskScheduler &ts) -> cotask::Task<void> {
+  std::cout << "async_fn4 - start\n";
+
+  auto walker = cotask::DirectoryWalker{ts, "src"};
+  auto files = std::vector<std::filesystem::path>{};
+  while (true) {
+    auto walk_result = co_await walker.next();
+    if (walk_result.entries.empty()) {
+      break;
+    }
+    for (const auto &entry : walk_result.entries) {
+      if (not entry.is_directory) {
+        files.push_back(entry.path);
+      }
+    }
+  }
+
+  co_await walker.close();
+
+  auto stat_result = co_await cotask::FileStatBatch{ts, files};
+  for (const auto &stat : stat_result.stats) {
+    std::cout << std::format("async_fn4 - {} ({} bytes)\n", stat.path.string(), stat.size);
+  }
+
+  std::cout << "async_fn4 - done\n";
+  co_return;
+};
+
+auto async_append(cotask::TaskScheduler &, cotask::DurableLog *log, int n) -> cotask::Task<void> {
+  for (auto i = 0; i < 3; ++i) {
+    auto record = std::format("record {}-{}\n", n, i);
+    auto append_result = co_await log->append(record);
+    std::cout << std::format("async_append {} - offset {} durable: {}\n", n, append_result.offset,
+                             append_result.success);
+  }
+  co_return;
+};
+
+auto async_fn5(cotask::TaskScheduler &ts) -> cotask::Task<void> {
+  std::cout << "async_fn5 - start\n";
+
+  auto log = cotask::DurableLog{ts, "durable.log"};
+  auto t1 = async_append(ts, &log, 1);
+  auto t2 = async_append(ts, &log, 2);
+  co_await t1;
+  co_await t2;
+  co_await log.close();
+  std::cout << std::format("async_fn5 - {} records in {} batches\n", log.stats.records, log.stats.batches);
+
+  std::cout << "async_fn5 - done\n";
+  co_return;
+};
+
 auto main() -> int {
   auto ts = cotask::TaskScheduler{};
   ts.schedule_from_sync(async_fn0(ts));
   ts.schedule_from_sync(async_fn2(ts));
+  ts.schedule_from_sync(async_fn3(ts));
+  ts.schedule_from_sync(async_fn4(ts));
+  ts.schedule_from_sync(async_fn5(ts));
   ts.execute();
 
   return EXIT_SUCCESS;
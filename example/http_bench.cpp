@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <iostream>
+#include <algorithm>
+#include <string_view>
+
+#include <cotask/http.hpp>
+
+// load test against `cotask-example-http-server`: N keep alive connections, requests/s and latency percentiles
+// usage: cotask-example-http-bench [connections = 64] [requests per connection = 1000]
+
+constexpr auto request = std::string_view{"GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"};
+
+auto content_length(std::string_view head) -> std::size_t {
+  constexpr auto name = std::string_view{"Content-Length: "};
+  auto length = std::size_t{0};
+  const auto pos = head.find(name);
+  if (pos != std::string_view::npos) {
+    const auto value = head.substr(pos + name.size());
+    std::from_chars(value.data(), value.data() + value.size(), length);
+  }
+  return length;
+}
+
+auto async_client(cotask::TaskScheduler &ts, int requests, std::vector<double> *latencies, int *failed)
+  -> cotask::Task<void> {
+  auto conn_socket = cotask::TcpSocket{ts, cotask::SocketOptions::low_latency()};
+  auto connect_result = co_await cotask::TcpConnect{&conn_socket, "127.0.0.1", "8080"};
+  if (not connect_result.success) {
+    *failed += 1;
+    co_return;
+  }
+
+  auto stream = cotask::TcpStream{&conn_socket};
+  for (auto i = 0; i < requests; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    auto send_result = co_await cotask::TcpSendAll{&conn_socket, request};
+    if (not send_result.success) {
+      *failed += 1;
+      break;
+    }
+
+    auto head_result = co_await stream.read_until("\r\n\r\n");
+    if (not head_result.success) {
+      *failed += 1;
+      break;
+    }
+    auto body_result = co_await stream.read_exact(content_length(head_result.get_string_view()));
+    if (not body_result.success) {
+      *failed += 1;
+      break;
+    }
+
+    latencies->push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  conn_socket.close();
+}
+
+auto percentile(const std::vector<double> &sorted, double p) -> double {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const auto index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1));
+  return sorted[index];
+}
+
+auto main(int argc, char **argv) -> int {
+  const auto connections = argc > 1 ? std::atoi(argv[1]) : 64;
+  const auto requests = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+  cotask::net_init();
+
+  auto latencies = std::vector<double>{};
+  latencies.reserve(static_cast<std::size_t>(connections) * static_cast<std::size_t>(requests));
+  auto failed = 0;
+
+  auto ts = cotask::TaskScheduler{};
+  for (auto i = 0; i < connections; ++i) {
+    ts.schedule_from_sync(async_client(ts, requests, &latencies, &failed));
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  ts.execute();
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::sort(latencies.begin(), latencies.end());
+  std::cout << std::format("connections: {}, requests: {}, failed: {}\n", connections, latencies.size(), failed);
+  std::cout << std::format("requests/s:  {:.0f}\n", static_cast<double>(latencies.size()) / elapsed);
+  std::cout << std::format("latency p50: {:.1f} us, p99: {:.1f} us, max: {:.1f} us\n", percentile(latencies, 0.50),
+                           percentile(latencies, 0.99), latencies.empty() ? 0.0 : latencies.back());
+
+  cotask::net_deinit();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <iostream>
+
+#include <cotask/http.hpp>
+
+// keep alive / pipelining http server on port 8080, `cotask-example-http-bench` loads it
+
+auto handle(const cotask::http::Request &request, cotask::http::Response &response) -> void {
+  if (request.target == "/") {
+    response.add_header("Content-Type", "text/plain");
+    response.body = "hello from cotask http server!\n";
+    return;
+  }
+
+  if (request.target == "/echo") {
+    // a view into the request, valid until the response is sent
+    response.add_header("Content-Type", "application/octet-stream");
+    response.body = request.body;
+    return;
+  }
+
+  response.status = 404;
+}
+
+auto async_connection(cotask::TaskScheduler &ts, std::shared_ptr<cotask::TcpSocket> client_socket)
+  -> cotask::Task<void> {
+  co_await cotask::http::serve(ts, client_socket.get(), handle);
+}
+
+auto async_server(cotask::TaskScheduler &ts, cotask::TcpSocket *listen_socket) -> cotask::Task<void> {
+  auto accept_stream = cotask::AcceptStream{listen_socket};
+  while (true) {
+    auto batch = co_await accept_stream.next();
+    if (not batch.success) {
+      break;
+    }
+    for (auto &client_socket : batch.sockets) {
+      // detached: the frame and the socket are freed when the connection ends
+      ts.schedule_detached(async_connection(ts, std::move(client_socket)));
+    }
+  }
+  co_await accept_stream.close();
+}
+
+auto main() -> int {
+  cotask::net_init();
+
+  auto ts = cotask::TaskScheduler{};
+  auto listen_socket = cotask::TcpSocket{ts, cotask::SocketOptions::low_latency()};
+  if (not listen_socket.listen(8080)) {
+    return EXIT_FAILURE;
+  }
+
+  ts.schedule_from_sync(async_server(ts, &listen_socket));
+  std::cout << "http server listening on 8080\n";
+  ts.execute();
+
+  listen_socket.close();
+
+  cotask::net_deinit();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#include <cstdlib>
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <cotask/rpc.hpp>
+
+// many concurrent calls multiplexed over one connection
+
+constexpr auto caller_count = 64;
+constexpr auto calls_per_caller = 1000;
+
+constexpr auto method_echo = std::uint32_t{1};
+
+auto handle(cotask::TaskScheduler &, std::uint32_t method, std::string body) -> cotask::Task<cotask::RpcReply> {
+  if (method != method_echo) {
+    co_return cotask::RpcReply{.status = 1, .body = "unknown method"};
+  }
+  co_return cotask::RpcReply{.status = 0, .body = std::move(body)};
+}
+
+auto async_server(cotask::TaskScheduler &ts, cotask::TcpSocket *listen_socket) -> cotask::Task<void> {
+  auto client_socket = cotask::TcpSocket{ts};
+  auto accept_result = co_await cotask::TcpAccept{listen_socket, &client_socket};
+  if (not accept_result.success) {
+    co_return;
+  }
+
+  auto conn = cotask::RpcServerConnection{&client_socket, handle};
+  co_await conn.serve();
+  std::cout << std::format("server - requests: {}, max in flight: {}\n", conn.stats.requests,
+                           conn.stats.max_in_flight);
+}
+
+auto async_caller(cotask::TaskScheduler &, cotask::RpcClient *client, int n, int *failed) -> cotask::Task<void> {
+  for (auto i = 0; i < calls_per_caller; ++i) {
+    const auto body = std::format("caller {} call {}", n, i);
+    auto call_result = co_await client->call(method_echo, body);
+    if (not call_result.success or call_result.body != body) {
+      *failed += 1;
+    }
+  }
+}
+
+auto async_client(cotask::TaskScheduler &ts) -> cotask::Task<void> {
+  auto conn_socket = cotask::TcpSocket{ts, cotask::SocketOptions::low_latency()};
+  auto connect_result = co_await cotask::TcpConnect{&conn_socket, "localhost", "8002"};
+  if (not connect_result.success) {
+    co_return;
+  }
+
+  auto client = cotask::RpcClient{&conn_socket};
+  auto failed = 0;
+  const auto start = std::chrono::steady_clock::now();
+  // callers run concurrently from creation, their calls share the connection
+  auto callers = std::vector<cotask::Task<void>>{};
+  for (auto i = 0; i < caller_count; ++i) {
+    callers.push_back(async_caller(ts, &client, i, &failed));
+  }
+  for (auto &caller : callers) {
+    co_await caller;
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << std::format("client - calls: {}, failed: {}, max in flight: {}, calls/s: {:.0f}\n",
+                           client.stats.calls, failed, client.stats.max_in_flight,
+                           static_cast<double>(client.stats.calls) / elapsed);
+  co_await client.close();
+}
+
+auto main() -> int {
+  cotask::net_init();
+
+  auto ts = cotask::TaskScheduler{};
+  auto listen_socket = cotask::TcpSocket{ts};
+  if (not listen_socket.listen(8002)) {
+    return EXIT_FAILURE;
+  }
+
+  ts.schedule_from_sync(async_server(ts, &listen_socket));
+  ts.schedule_from_sync(async_client(ts));
+  ts.execute();
+
+  listen_socket.close();
+
+  cotask::net_deinit();
+  return EXIT_SUCCESS;
+}
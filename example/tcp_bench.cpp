@@ -0,0 +1,110 @@
+#include <cstdlib>
+#include <array>
+#include <chrono>
+#include <format>
+#include <vector>
+#include <iostream>
+#include <string_view>
+
+#include <cotask/tcp.hpp>
+
+// compares the socket option presets over loopback: ping-pong latency and bulk throughput
+
+constexpr auto ping_count = 10000;
+constexpr auto ping_size = 64;
+constexpr auto bulk_chunk_size = 1024 * 1024;
+constexpr auto bulk_chunk_count = 256;
+
+auto async_echo_server(cotask::TaskScheduler &ts, cotask::TcpSocket *listen_socket) -> cotask::Task<void> {
+  auto client_socket = cotask::TcpSocket{ts};
+  auto accept_result = co_await cotask::TcpAccept{listen_socket, &client_socket};
+  if (not accept_result.success) {
+    co_return;
+  }
+
+  // ping-pong
+  auto ping_buf = std::array<char, ping_size>{};
+  for (auto i = 0; i < ping_count; ++i) {
+    auto recv_result = co_await cotask::TcpRecvAll{&client_socket, ping_buf};
+    if (not recv_result.success) {
+      co_return;
+    }
+    auto send_result = co_await cotask::TcpSendAll{&client_socket, ping_buf};
+    if (not send_result.success) {
+      co_return;
+    }
+  }
+
+  // bulk: read everything, then ack with one byte
+  auto bulk_buf = std::vector<char>(bulk_chunk_size);
+  for (auto i = 0; i < bulk_chunk_count; ++i) {
+    auto recv_result = co_await cotask::TcpRecvAll{&client_socket, bulk_buf};
+    if (not recv_result.success) {
+      co_return;
+    }
+  }
+  co_await cotask::TcpSendAll{&client_socket, std::string_view{"k"}};
+
+  client_socket.close();
+}
+
+auto async_bench_client(cotask::TaskScheduler &ts, std::string_view name, cotask::SocketOptions options)
+  -> cotask::Task<void> {
+  auto conn_socket = cotask::TcpSocket{ts, options};
+  auto connect_result = co_await cotask::TcpConnect{&conn_socket, "localhost", "8001"};
+  if (not connect_result.success) {
+    co_return;
+  }
+
+  // ping-pong latency
+  auto ping_buf = std::array<char, ping_size>{};
+  auto start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < ping_count; ++i) {
+    co_await cotask::TcpSendAll{&conn_socket, ping_buf};
+    auto recv_result = co_await cotask::TcpRecvAll{&conn_socket, ping_buf};
+    if (not recv_result.success) {
+      co_return;
+    }
+  }
+  auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+  std::cout << std::format("{:16} ping-pong: {:8.2f} us/round trip\n", name, elapsed.count() / ping_count);
+
+  // bulk throughput
+  auto bulk_buf = std::vector<char>(bulk_chunk_size, 'x');
+  start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < bulk_chunk_count; ++i) {
+    co_await cotask::TcpSendAll{&conn_socket, bulk_buf};
+  }
+  auto ack_buf = std::array<char, 1>{};
+  co_await cotask::TcpRecvAll{&conn_socket, ack_buf};
+  elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+  const auto megabytes = static_cast<double>(bulk_chunk_size) * bulk_chunk_count / (1024.0 * 1024.0);
+  std::cout << std::format("{:16} bulk:      {:8.2f} MiB/s\n", name, megabytes / (elapsed.count() / 1'000'000.0));
+
+  conn_socket.close();
+}
+
+auto run_bench(std::string_view name, cotask::SocketOptions options) -> void {
+  auto ts = cotask::TaskScheduler{};
+  auto listen_socket = cotask::TcpSocket{ts, options};
+  if (not listen_socket.listen(8001)) {
+    return;
+  }
+
+  ts.schedule_from_sync(async_echo_server(ts, &listen_socket));
+  ts.schedule_from_sync(async_bench_client(ts, name, options));
+  ts.execute();
+
+  listen_socket.close();
+}
+
+auto main() -> int {
+  cotask::net_init();
+
+  run_bench("default", {});
+  run_bench("low latency", cotask::SocketOptions::low_latency());
+  run_bench("bulk throughput", cotask::SocketOptions::bulk_throughput());
+
+  cotask::net_deinit();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <new>
+#include <memory_resource>
+
+namespace cotask {
+
+struct ConnectionArenaStats {
+  std::uint64_t allocations = 0;
+  std::uint64_t bytes = 0;
+  std::uint64_t blocks = 0; // taken from upstream
+  std::uint64_t releases = 0;
+  std::size_t live_frames = 0;
+};
+
+// bump allocator for everything one connection allocates (`std::pmr` containers, coroutine frames),
+// deallocation is a no-op and everything is freed in one shot by `release`
+// (not thread safe, an arena stays within one scheduler)
+//
+// frames find the arena through their header, so the arena must outlive every frame placed in it:
+// start connection coroutines with `schedule_detached` (or await them), a frame kept by `schedule_from_sync`
+// is only destroyed when `execute` returns and holds the release back until then
+struct ConnectionArena : public std::pmr::memory_resource {
+private:
+  struct Block {
+    Block *next;
+    std::size_t size; // bytes after the header
+  };
+
+  static constexpr auto block_header_size = (sizeof(Block) + alignof(std::max_align_t) - 1) &
+                                            ~(alignof(std::max_align_t) - 1);
+
+public:
+  std::pmr::memory_resource &upstream;
+  const std::size_t block_size;
+  ConnectionArenaStats stats;
+
+private:
+  Block *blocks = nullptr; // the first block is kept across releases
+  char *cursor = nullptr;
+  char *end = nullptr;
+  bool release_pending = false;
+
+public:
+  inline explicit ConnectionArena(std::size_t block_size = 64 * 1024,
+                                  std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+      : upstream{*upstream}, block_size{block_size} {}
+
+  inline ConnectionArena(const ConnectionArena &other) = delete;
+
+  inline ~ConnectionArena() override {
+    assert(stats.live_frames == 0 and "ConnectionArena must outlive the coroutine frames placed in it");
+    if (stats.live_frames != 0) {
+      // the blocks still hold frames, leaking them is better than freeing memory that is in use
+      return;
+    }
+    free_blocks(nullptr);
+  }
+
+public:
+  [[nodiscard]] inline auto allocator() -> std::pmr::polymorphic_allocator<std::byte> {
+    return {this};
+  }
+
+  // frees everything allocated so far, deferred until the last coroutine frame in the arena is destroyed
+  // (objects outside those frames that point into the arena must be dead already),
+  // reuse the arena for another connection only once `is_release_pending()` is false
+  inline auto release() -> void {
+    if (stats.live_frames != 0) {
+      release_pending = true;
+      return;
+    }
+    release_pending = false;
+    stats.releases += 1;
+
+    // keep the first block, the next connection reuses it without going to upstream
+    auto keep = blocks;
+    while (keep != nullptr and keep->next != nullptr) {
+      keep = keep->next;
+    }
+    free_blocks(keep);
+    blocks = keep;
+    if (keep != nullptr) {
+      keep->next = nullptr;
+      cursor = reinterpret_cast<char *>(keep) + block_header_size;
+      end = cursor + keep->size;
+    } else {
+      cursor = nullptr;
+      end = nullptr;
+    }
+  }
+
+  [[nodiscard]] inline auto is_release_pending() const -> bool {
+    return release_pending;
+  }
+
+  // coroutine frames are counted, `release` waits for them
+  inline auto allocate_frame(std::size_t bytes) -> void * {
+    stats.live_frames += 1;
+    return allocate(bytes, alignof(std::max_align_t));
+  }
+
+  inline auto deallocate_frame(void *, std::size_t) -> void {
+    stats.live_frames -= 1;
+    if (stats.live_frames == 0 and release_pending) {
+      release();
+    }
+  }
+
+protected:
+  inline auto do_allocate(std::size_t bytes, std::size_t alignment) -> void * override {
+    stats.allocations += 1;
+    stats.bytes += bytes;
+
+    auto ptr = align(cursor, alignment);
+    if (ptr == nullptr or ptr + bytes > end) {
+      // new blocks go in front, the oldest one is kept on release
+      const auto size = bytes + alignment > block_size ? bytes + alignment : block_size;
+      auto memory = static_cast<char *>(upstream.allocate(block_header_size + size, alignof(std::max_align_t)));
+      blocks = ::new (memory) Block{.next = blocks, .size = size};
+      stats.blocks += 1;
+      cursor = memory + block_header_size;
+      end = cursor + size;
+      ptr = align(cursor, alignment);
+    }
+    cursor = ptr + bytes;
+    return ptr;
+  }
+
+  inline auto do_deallocate(void *, std::size_t, std::size_t) -> void override {}
+
+  [[nodiscard]] inline auto do_is_equal(const std::pmr::memory_resource &other) const noexcept -> bool override {
+    return this == &other;
+  }
+
+private:
+  [[nodiscard]] static inline auto align(char *ptr, std::size_t alignment) -> char * {
+    if (ptr == nullptr) {
+      return nullptr;
+    }
+    const auto addr = reinterpret_cast<std::uintptr_t>(ptr);
+    return ptr + ((alignment - addr % alignment) % alignment);
+  }
+
+  // frees every block up to `last` (exclusive)
+  inline auto free_blocks(Block *last) -> void {
+    while (blocks != nullptr and blocks != last) {
+      auto next = blocks->next;
+      upstream.deallocate(blocks, block_header_size + blocks->size, alignof(std::max_align_t));
+      blocks = next;
+    }
+  }
+};
+
+// picks the arena for a coroutine frame from the coroutine arguments
+inline auto arena_of(ConnectionArena *arena) -> ConnectionArena * {
+  return arena;
+}
+
+template <typename T>
+inline auto arena_of(const T &) -> ConnectionArena * {
+  return nullptr;
+}
+
+template <typename... Args>
+inline auto find_arena(const Args &...args) -> ConnectionArena * {
+  auto arena = static_cast<ConnectionArena *>(nullptr);
+  ((arena = arena != nullptr ? arena : arena_of(args)), ...);
+  return arena;
+}
+
+// coroutine frame allocation, the header records where the frame came from
+struct TaskFrame {
+  static constexpr auto header_size = alignof(std::max_align_t);
+
+  [[nodiscard]] static inline auto allocate(std::size_t size, ConnectionArena *arena) -> void * {
+    auto memory = arena != nullptr ? arena->allocate_frame(header_size + size) : ::operator new(header_size + size);
+    *static_cast<ConnectionArena **>(memory) = arena;
+    return static_cast<char *>(memory) + header_size;
+  }
+
+  static inline auto deallocate(void *ptr, std::size_t size) -> void {
+    auto memory = static_cast<char *>(ptr) - header_size;
+    auto arena = *reinterpret_cast<ConnectionArena **>(memory);
+    if (arena != nullptr) {
+      arena->deallocate_frame(memory, header_size + size);
+    } else {
+      ::operator delete(memory, header_size + size);
+    }
+  }
+};
+
+} // namespace cotask
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+#include <cotask/iobuf.hpp>
+
+#include <span>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <string_view>
+
+namespace cotask {
+
+struct Broadcaster;
+struct BroadcastSubscriber;
+
+// immutable buffer shared by reference count, an `IoBuf` segment
+// (the count is not atomic, a buffer stays within one scheduler)
+struct SharedBuffer {
+  IoBufSegment segment;
+
+  inline SharedBuffer() = default;
+
+  // shares the segment (a payload received into an `IoBuf`) without copying it
+  inline explicit SharedBuffer(IoBufSegment segment) : segment{std::move(segment)} {}
+
+  // copies `buf` once, every holder shares it afterwards
+  [[nodiscard]] static inline auto make(std::string_view buf) -> SharedBuffer {
+    auto shared = SharedBuffer{IoBufSegment{IoBufBlock::create(buf.size()), 0, buf.size()}};
+    if (not buf.empty()) {
+      std::memcpy(shared.segment.block->data(), buf.data(), buf.size());
+    }
+    return shared;
+  }
+
+  [[nodiscard]] inline auto get() const -> std::span<const char> {
+    if (segment.block == nullptr) {
+      return {};
+    }
+    return segment.get();
+  }
+
+  [[nodiscard]] inline auto size() const -> std::size_t {
+    return segment.size;
+  }
+
+  [[nodiscard]] inline auto use_count() const -> std::size_t {
+    return segment.block == nullptr ? 0 : segment.block->refs;
+  }
+
+  inline auto release() -> void {
+    segment.release();
+    segment.offset = 0;
+    segment.size = 0;
+  }
+};
+
+enum struct BroadcastOverflow {
+  Drop,       // the message is skipped for the slow subscriber
+  Disconnect, // the slow subscriber is closed
+};
+
+struct BroadcastOptions {
+  // per subscriber, a message that does not fit is handled by `overflow`
+  std::size_t max_queued_bytes = 4 * 1024 * 1024;
+  std::size_t max_queued_messages = 1024;
+  std::size_t max_batch_buffers = 64; // messages per vectored send
+  BroadcastOverflow overflow = BroadcastOverflow::Drop;
+};
+
+struct BroadcastStats {
+  std::uint64_t messages = 0;
+  std::uint64_t queued = 0;       // message deliveries queued to subscribers
+  std::uint64_t dropped = 0;      // deliveries skipped for slow subscribers
+  std::uint64_t disconnected = 0; // slow subscribers closed
+  std::uint64_t sends = 0;
+  std::uint64_t bytes = 0;
+};
+
+// suspends a subscriber writer until there is something to send
+struct BroadcastSubscriberIdle {
+  BroadcastSubscriber &subscriber;
+
+  [[nodiscard]] inline auto await_ready() const -> bool;
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  inline auto await_resume() const noexcept -> void;
+};
+
+// outbound queue of shared buffers for one socket, sends never wait for other subscribers
+struct BroadcastSubscriber {
+public:
+  Broadcaster &broadcaster;
+  TcpSocket &tcp_socket;
+
+  bool success = true;
+  bool closing = false;
+  bool closed = false; // the writer has stopped
+  bool *writer_is_waiting = nullptr;
+
+  std::deque<SharedBuffer> queued;
+  std::size_t queued_bytes = 0;
+  std::uint64_t dropped = 0;
+
+public:
+  inline BroadcastSubscriber(Broadcaster *broadcaster, TcpSocket *sock);
+  inline BroadcastSubscriber(const BroadcastSubscriber &other) = delete;
+
+public:
+  // never suspends, false when the message was dropped or the subscriber is gone
+  inline auto push(const SharedBuffer &buf) -> bool;
+
+  inline auto wake_writer() -> void {
+    if (writer_is_waiting != nullptr) {
+      *writer_is_waiting = false;
+    }
+  }
+
+private:
+  static inline auto run(TaskScheduler &ts, BroadcastSubscriber *subscriber) -> Task<void>;
+};
+
+// resumes once every subscriber writer has stopped
+struct BroadcasterClose {
+  Broadcaster &broadcaster;
+
+  [[nodiscard]] inline auto await_ready() const -> bool;
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  inline auto await_resume() const noexcept -> void {}
+};
+
+// fan out of shared buffers to many sockets
+struct Broadcaster {
+public:
+  TaskScheduler &ts;
+  BroadcastOptions options;
+  BroadcastStats stats;
+
+  std::vector<std::unique_ptr<BroadcastSubscriber>> subscribers;
+  std::size_t running = 0; // subscriber writers that have not stopped
+  bool *close_is_waiting = nullptr;
+
+public:
+  inline explicit Broadcaster(TaskScheduler &ts, BroadcastOptions options = {}) : ts{ts}, options{options} {
+    if (this->options.max_batch_buffers == 0) {
+      this->options.max_batch_buffers = 1;
+    }
+  }
+
+  inline Broadcaster(const Broadcaster &other) = delete;
+
+  inline ~Broadcaster() {
+    assert(running == 0 and "Broadcaster must be closed (co_await broadcaster.close()) before it is destroyed");
+  }
+
+public:
+  // the socket must outlive the subscription
+  inline auto subscribe(TcpSocket *sock) -> BroadcastSubscriber * {
+    subscribers.push_back(std::make_unique<BroadcastSubscriber>(this, sock));
+    return subscribers.back().get();
+  }
+
+  // queues the buffer for every subscriber, returns the number of subscribers it was queued for
+  inline auto broadcast(const SharedBuffer &buf) -> std::size_t {
+    stats.messages += 1;
+    auto count = std::size_t{0};
+    for (auto &subscriber : subscribers) {
+      count += subscriber->push(buf) ? 1 : 0;
+    }
+    return count;
+  }
+
+  // queues the buffer for the given subscribers (a topic)
+  inline auto broadcast(const SharedBuffer &buf, std::span<BroadcastSubscriber *const> targets) -> std::size_t {
+    stats.messages += 1;
+    auto count = std::size_t{0};
+    for (const auto subscriber : targets) {
+      count += subscriber->push(buf) ? 1 : 0;
+    }
+    return count;
+  }
+
+  // removes subscribers whose writer stopped (closed by the peer or disconnected as slow)
+  inline auto remove_closed() -> std::size_t {
+    const auto before = subscribers.size();
+    std::erase_if(subscribers, [](const auto &subscriber) { return subscriber->closed; });
+    return before - subscribers.size();
+  }
+
+  // flushes what is queued and stops every writer, must be awaited before the broadcaster is destroyed
+  inline auto close() -> BroadcasterClose {
+    for (auto &subscriber : subscribers) {
+      subscriber->closing = true;
+      subscriber->wake_writer();
+    }
+    return {*this};
+  }
+
+  inline auto writer_stopped() -> void {
+    running -= 1;
+    if (running == 0 and close_is_waiting != nullptr) {
+      *close_is_waiting = false;
+    }
+  }
+};
+
+inline BroadcastSubscriber::BroadcastSubscriber(Broadcaster *broadcaster, TcpSocket *sock)
+    : broadcaster{*broadcaster}, tcp_socket{*sock} {
+  broadcaster->running += 1;
+  broadcaster->ts.schedule_detached(run(broadcaster->ts, this));
+}
+
+inline auto BroadcastSubscriber::push(const SharedBuffer &buf) -> bool {
+  if (closing or not success) {
+    return false;
+  }
+
+  auto &options = broadcaster.options;
+  if (queued.size() >= options.max_queued_messages or queued_bytes + buf.size() > options.max_queued_bytes) {
+    // slow subscriber, the others are not held back
+    if (options.overflow == BroadcastOverflow::Disconnect) {
+      broadcaster.stats.disconnected += 1;
+      success = false;
+      queued.clear();
+      queued_bytes = 0;
+      // a send in flight fails, the writer stops
+      tcp_socket.close();
+      wake_writer();
+    } else {
+      broadcaster.stats.dropped += 1;
+      dropped += 1;
+    }
+    return false;
+  }
+
+  broadcaster.stats.queued += 1;
+  queued_bytes += buf.size();
+  queued.push_back(buf);
+  wake_writer();
+  return true;
+}
+
+inline auto BroadcastSubscriberIdle::await_ready() const -> bool {
+  return not subscriber.queued.empty() or subscriber.closing or not subscriber.success;
+}
+
+template <typename TaskResult, typename Promise>
+inline auto BroadcastSubscriberIdle::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  subscriber.writer_is_waiting = &cohandle.promise().is_waiting;
+  *subscriber.writer_is_waiting = true;
+}
+
+template <typename Promise>
+inline auto BroadcastSubscriberIdle::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  subscriber.writer_is_waiting = &cohandle.promise().is_waiting;
+  *subscriber.writer_is_waiting = true;
+}
+
+inline auto BroadcastSubscriberIdle::await_resume() const noexcept -> void {
+  subscriber.writer_is_waiting = nullptr;
+}
+
+inline auto BroadcasterClose::await_ready() const -> bool {
+  return broadcaster.running == 0;
+}
+
+template <typename TaskResult, typename Promise>
+inline auto BroadcasterClose::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  broadcaster.close_is_waiting = &cohandle.promise().is_waiting;
+  *broadcaster.close_is_waiting = true;
+}
+
+template <typename Promise>
+inline auto BroadcasterClose::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  broadcaster.close_is_waiting = &cohandle.promise().is_waiting;
+  *broadcaster.close_is_waiting = true;
+}
+
+inline auto BroadcastSubscriber::run(TaskScheduler &, BroadcastSubscriber *subscriber) -> Task<void> {
+  // the batch holds its references until the send completed, the last one frees the buffer
+  auto batch = std::vector<SharedBuffer>{};
+  auto batch_bufs = std::vector<std::span<const char>>{};
+
+  while (subscriber->success) {
+    if (subscriber->queued.empty()) {
+      if (subscriber->closing) {
+        break;
+      }
+      co_await BroadcastSubscriberIdle{*subscriber};
+      continue;
+    }
+
+    batch.clear();
+    batch_bufs.clear();
+    auto batch_bytes = std::size_t{0};
+    while (not subscriber->queued.empty() and batch.size() < subscriber->broadcaster.options.max_batch_buffers) {
+      batch_bytes += subscriber->queued.front().size();
+      batch.push_back(std::move(subscriber->queued.front()));
+      subscriber->queued.pop_front();
+    }
+    for (const auto &buf : batch) {
+      batch_bufs.push_back(buf.get());
+    }
+
+    auto send_result = co_await TcpSendAllV{&subscriber->tcp_socket, batch_bufs};
+    if (subscriber->success) {
+      // (a disconnect already reset the queue)
+      subscriber->queued_bytes -= batch_bytes;
+      subscriber->success = send_result.success;
+    }
+    subscriber->broadcaster.stats.sends += 1;
+    subscriber->broadcaster.stats.bytes += send_result.bytes_sent;
+  }
+
+  batch.clear();
+  subscriber->queued.clear();
+  subscriber->queued_bytes = 0;
+  subscriber->closed = true;
+  subscriber->broadcaster.writer_stopped();
+}
+
+} // namespace cotask
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <array>
+#include <vector>
+#include <utility>
+
+namespace cotask {
+
+struct AlignedBufferPool;
+
+// buffer leased from `AlignedBufferPool`, returned to the pool on destruction
+struct AlignedBuffer {
+  AlignedBufferPool *pool = nullptr;
+  std::span<char> buf;
+
+  inline AlignedBuffer() = default;
+  inline AlignedBuffer(AlignedBufferPool *pool, std::span<char> buf) : pool{pool}, buf{buf} {}
+  inline AlignedBuffer(const AlignedBuffer &other) = delete;
+
+  inline AlignedBuffer(AlignedBuffer &&other) noexcept
+      : pool{std::exchange(other.pool, nullptr)}, buf{std::exchange(other.buf, {})} {}
+
+  inline auto operator=(AlignedBuffer &&other) noexcept -> AlignedBuffer & {
+    if (this != &other) {
+      release();
+      pool = std::exchange(other.pool, nullptr);
+      buf = std::exchange(other.buf, {});
+    }
+    return *this;
+  }
+
+  inline ~AlignedBuffer() {
+    release();
+  }
+
+  [[nodiscard]] inline auto empty() const -> bool {
+    return buf.empty();
+  }
+
+  inline auto release() -> void;
+};
+
+// page aligned buffers in fixed size classes (used for unbuffered file io and pooled tcp recv)
+struct AlignedBufferPool {
+  static constexpr auto alignment = std::size_t{4096};
+  static constexpr auto size_classes = std::array<std::size_t, 5>{
+    4 * 1024,
+    16 * 1024,
+    64 * 1024,
+    1024 * 1024,
+    8 * 1024 * 1024,
+  };
+
+private:
+  std::array<std::vector<char *>, size_classes.size()> free_lists;
+
+public:
+  inline AlignedBufferPool() = default;
+  inline AlignedBufferPool(const AlignedBufferPool &other) = delete;
+
+  inline ~AlignedBufferPool() {
+    for (auto &free_list : free_lists) {
+      for (auto ptr : free_list) {
+        ::operator delete[](ptr, std::align_val_t{alignment});
+      }
+      free_list.clear();
+    }
+  }
+
+public:
+  [[nodiscard]] static inline auto align_down(std::uint64_t n) -> std::uint64_t {
+    return n & ~std::uint64_t{alignment - 1};
+  }
+
+  [[nodiscard]] static inline auto align_up(std::uint64_t n) -> std::uint64_t {
+    return align_down(n + alignment - 1);
+  }
+
+  [[nodiscard]] static inline auto is_aligned(const void *ptr) -> bool {
+    return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+  }
+
+  // returns a buffer of at least `size` bytes
+  inline auto acquire(std::size_t size) -> AlignedBuffer {
+    for (auto i = std::size_t{0}; i < size_classes.size(); ++i) {
+      if (size <= size_classes[i]) {
+        auto &free_list = free_lists[i];
+        auto ptr = static_cast<char *>(nullptr);
+        if (free_list.empty()) {
+          ptr = static_cast<char *>(::operator new[](size_classes[i], std::align_val_t{alignment}));
+        } else {
+          ptr = free_list.back();
+          free_list.pop_back();
+        }
+        return {this, {ptr, size_classes[i]}};
+      }
+    }
+
+    // larger than the largest size class (not pooled)
+    const auto aligned_size = static_cast<std::size_t>(align_up(size));
+    auto ptr = static_cast<char *>(::operator new[](aligned_size, std::align_val_t{alignment}));
+    return {this, {ptr, aligned_size}};
+  }
+
+  inline auto release(std::span<char> buf) -> void {
+    for (auto i = std::size_t{0}; i < size_classes.size(); ++i) {
+      if (buf.size() == size_classes[i]) {
+        free_lists[i].push_back(buf.data());
+        return;
+      }
+    }
+    ::operator delete[](buf.data(), std::align_val_t{alignment});
+  }
+};
+
+inline auto AlignedBuffer::release() -> void {
+  if (pool != nullptr and not buf.empty()) {
+    pool->release(buf);
+  }
+  pool = nullptr;
+  buf = {};
+}
+
+} // namespace cotask
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <string_view>
+#include <unordered_map>
+
+namespace cotask {
+
+struct TcpConnectionPool;
+struct TcpConnectionPoolEndpoint;
+struct TcpConnectionPoolAcquire;
+
+struct TcpConnectionPoolOptions {
+  std::size_t max_total = 16; // per endpoint, leased + idle + connecting
+  std::size_t max_idle = 8;   // per endpoint
+  std::chrono::seconds idle_timeout{60};
+  SocketOptions socket_options = SocketOptions::low_latency();
+};
+
+struct TcpConnectionPoolStats {
+  std::uint64_t acquires = 0;
+  std::uint64_t reused = 0;
+  std::uint64_t connects = 0;
+  std::uint64_t connect_failures = 0;
+  std::uint64_t dead_dropped = 0; // idle connections closed by the peer or timed out
+  std::uint64_t waits = 0;        // acquires that waited for a connection
+  std::chrono::microseconds wait_time_total{0};
+  std::chrono::microseconds wait_time_max{0};
+
+  [[nodiscard]] inline auto reuse_rate() const -> double {
+    return acquires == 0 ? 0.0 : static_cast<double>(reused) / static_cast<double>(acquires);
+  }
+};
+
+// connected socket leased from a `TcpConnectionPool`, returned to it on destruction
+struct TcpPooledConnection {
+  TcpConnectionPool *pool = nullptr;
+  TcpConnectionPoolEndpoint *endpoint = nullptr;
+  std::unique_ptr<TcpSocket> socket; // heap allocated, the socket address is its completion key
+  bool reusable = true;
+
+  inline TcpPooledConnection() = default;
+  inline TcpPooledConnection(TcpConnectionPool *pool, TcpConnectionPoolEndpoint *endpoint,
+                             std::unique_ptr<TcpSocket> socket)
+      : pool{pool}, endpoint{endpoint}, socket{std::move(socket)} {}
+  inline TcpPooledConnection(const TcpPooledConnection &other) = delete;
+
+  inline TcpPooledConnection(TcpPooledConnection &&other) noexcept
+      : pool{std::exchange(other.pool, nullptr)}, endpoint{std::exchange(other.endpoint, nullptr)},
+        socket{std::move(other.socket)}, reusable{other.reusable} {}
+
+  inline auto operator=(TcpPooledConnection &&other) noexcept -> TcpPooledConnection & {
+    if (this != &other) {
+      release();
+      pool = std::exchange(other.pool, nullptr);
+      endpoint = std::exchange(other.endpoint, nullptr);
+      socket = std::move(other.socket);
+      reusable = other.reusable;
+    }
+    return *this;
+  }
+
+  inline ~TcpPooledConnection() {
+    release();
+  }
+
+  [[nodiscard]] inline auto get() const -> TcpSocket * {
+    return socket.get();
+  }
+
+  // the connection is closed instead of reused (after an error or a protocol level close)
+  inline auto discard() -> void {
+    reusable = false;
+  }
+
+  inline auto release() -> void;
+};
+
+struct TcpConnectionPoolAcquireResult {
+  bool finished = false;
+  bool success = false;
+  bool reused = false;
+  TcpPooledConnection connection;
+};
+
+// resumes with an idle connection, a new one or one released by another lease
+struct TcpConnectionPoolAcquire {
+public:
+  TcpConnectionPool &pool;
+  TcpConnectionPoolEndpoint &endpoint;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+  bool reused = false;
+  TcpPooledConnection connection;
+  std::chrono::steady_clock::time_point wait_start;
+
+public:
+  inline TcpConnectionPoolAcquire(TcpConnectionPool *pool, std::string_view host, std::string_view port);
+  inline TcpConnectionPoolAcquire(const TcpConnectionPoolAcquire &other) = delete;
+  inline ~TcpConnectionPoolAcquire();
+
+public:
+  inline auto io_acquired(std::unique_ptr<TcpSocket> socket, bool reused) -> void;
+  inline auto io_failed() -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> TcpConnectionPoolAcquireResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .reused = reused,
+      .connection = std::move(connection),
+    };
+  }
+};
+
+struct TcpConnectionPoolIdle {
+  std::unique_ptr<TcpSocket> socket;
+  std::chrono::steady_clock::time_point since;
+};
+
+struct TcpConnectionPoolEndpoint {
+  std::string host;
+  std::string port;
+  std::size_t total = 0;                         // leased + idle + connecting
+  std::size_t connecting = 0;
+  std::deque<TcpConnectionPoolIdle> idle;        // most recently released last
+  std::deque<TcpConnectionPoolAcquire *> waiters; // served in order
+};
+
+// keep alive connections per endpoint (host, port)
+struct TcpConnectionPool {
+public:
+  TaskScheduler &ts;
+  TcpConnectionPoolOptions options;
+  TcpConnectionPoolStats stats;
+
+  std::unordered_map<std::string, std::unique_ptr<TcpConnectionPoolEndpoint>> endpoints;
+
+public:
+  inline explicit TcpConnectionPool(TaskScheduler &ts, TcpConnectionPoolOptions options = {})
+      : ts{ts}, options{options} {
+    if (this->options.max_total == 0) {
+      this->options.max_total = 1;
+    }
+  }
+
+  inline TcpConnectionPool(const TcpConnectionPool &other) = delete;
+
+  inline ~TcpConnectionPool() {
+    for (auto &[key, endpoint] : endpoints) {
+      assert(endpoint->total == endpoint->idle.size() and "leases must be released before the pool is destroyed");
+      for (auto &idle : endpoint->idle) {
+        idle.socket->close();
+      }
+    }
+  }
+
+public:
+  [[nodiscard]] inline auto acquire(std::string_view host, std::string_view port) -> TcpConnectionPoolAcquire {
+    return {this, host, port};
+  }
+
+  inline auto endpoint(std::string_view host, std::string_view port) -> TcpConnectionPoolEndpoint & {
+    auto key = std::string{host};
+    key += ':';
+    key += port;
+
+    auto it = endpoints.find(key);
+    if (it == endpoints.end()) {
+      auto endpoint = std::make_unique<TcpConnectionPoolEndpoint>();
+      endpoint->host = host;
+      endpoint->port = port;
+      it = endpoints.emplace(std::move(key), std::move(endpoint)).first;
+    }
+    return *it->second;
+  }
+
+  // takes a live idle connection, closing dead and timed out ones on the way
+  inline auto take_idle(TcpConnectionPoolEndpoint &endpoint) -> std::unique_ptr<TcpSocket> {
+    const auto now = std::chrono::steady_clock::now();
+    while (not endpoint.idle.empty()) {
+      auto idle = std::move(endpoint.idle.back());
+      endpoint.idle.pop_back();
+      if (now - idle.since < options.idle_timeout and idle.socket->is_alive()) {
+        return std::move(idle.socket);
+      }
+      idle.socket->close();
+      endpoint.total -= 1;
+      stats.dead_dropped += 1;
+    }
+    return nullptr;
+  }
+
+  // hands a connection to the oldest waiter or parks it as idle
+  inline auto deliver(TcpConnectionPoolEndpoint &endpoint, std::unique_ptr<TcpSocket> socket, bool reused) -> void {
+    if (not endpoint.waiters.empty()) {
+      auto waiter = endpoint.waiters.front();
+      endpoint.waiters.pop_front();
+      waiter->io_acquired(std::move(socket), reused);
+      return;
+    }
+
+    if (endpoint.idle.size() >= options.max_idle) {
+      socket->close();
+      endpoint.total -= 1;
+      return;
+    }
+    endpoint.idle.push_back({std::move(socket), std::chrono::steady_clock::now()});
+  }
+
+  inline auto release(TcpConnectionPoolEndpoint &endpoint, std::unique_ptr<TcpSocket> socket, bool reusable) -> void {
+    if (reusable) {
+      deliver(endpoint, std::move(socket), true);
+      return;
+    }
+
+    socket->close();
+    endpoint.total -= 1;
+    if (not endpoint.waiters.empty()) {
+      // the slot is free again, connect for the oldest waiter
+      start_connect(endpoint);
+    }
+  }
+
+  inline auto start_connect(TcpConnectionPoolEndpoint &endpoint) -> void {
+    endpoint.total += 1;
+    endpoint.connecting += 1;
+    stats.connects += 1;
+    ts.schedule_detached(connect(ts, this, &endpoint));
+  }
+
+private:
+  static inline auto connect(TaskScheduler &ts, TcpConnectionPool *pool, TcpConnectionPoolEndpoint *endpoint)
+    -> Task<void> {
+    auto socket = std::make_unique<TcpSocket>(ts, pool->options.socket_options);
+    auto connect_result = co_await TcpConnect{socket.get(), endpoint->host, endpoint->port};
+    endpoint->connecting -= 1;
+    if (connect_result.success) {
+      pool->deliver(*endpoint, std::move(socket), false);
+      co_return;
+    }
+
+    pool->stats.connect_failures += 1;
+    endpoint->total -= 1;
+    if (not endpoint->waiters.empty()) {
+      auto waiter = endpoint->waiters.front();
+      endpoint->waiters.pop_front();
+      waiter->io_failed();
+    }
+
+    // the other waiters may have no connect of their own (queued beyond `max_total`), try again for them
+    if (endpoint->waiters.size() > endpoint->connecting and endpoint->total < pool->options.max_total) {
+      pool->start_connect(*endpoint);
+    }
+  }
+};
+
+inline auto TcpPooledConnection::release() -> void {
+  if (pool != nullptr and socket != nullptr) {
+    pool->release(*endpoint, std::move(socket), reusable);
+  }
+  pool = nullptr;
+  endpoint = nullptr;
+  socket = nullptr;
+}
+
+inline TcpConnectionPoolAcquire::TcpConnectionPoolAcquire(TcpConnectionPool *pool, std::string_view host,
+                                                          std::string_view port)
+    : pool{*pool}, endpoint{pool->endpoint(host, port)}, wait_start{std::chrono::steady_clock::now()} {
+  pool->stats.acquires += 1;
+
+  // reuse
+  if (endpoint.waiters.empty()) {
+    if (auto socket = pool->take_idle(endpoint); socket != nullptr) {
+      pool->stats.reused += 1;
+      finished = true;
+      success = true;
+      reused = true;
+      connection = {pool, &endpoint, std::move(socket)};
+      return;
+    }
+  }
+
+  // wait for a new connection or a released one
+  pool->stats.waits += 1;
+  endpoint.waiters.push_back(this);
+  if (endpoint.total < pool->options.max_total) {
+    pool->start_connect(endpoint);
+  }
+}
+
+inline TcpConnectionPoolAcquire::~TcpConnectionPoolAcquire() {
+  // a waiting acquire destroyed with its coroutine must not be delivered to
+  if (not finished) {
+    std::erase(endpoint.waiters, this);
+  }
+}
+
+inline auto TcpConnectionPoolAcquire::io_acquired(std::unique_ptr<TcpSocket> socket, bool reused) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = true;
+  this->reused = reused;
+  if (reused) {
+    pool.stats.reused += 1;
+  }
+  connection = {&pool, &endpoint, std::move(socket)};
+
+  const auto wait_time =
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wait_start);
+  pool.stats.wait_time_total += wait_time;
+  if (pool.stats.wait_time_max < wait_time) {
+    pool.stats.wait_time_max = wait_time;
+  }
+}
+
+inline auto TcpConnectionPoolAcquire::io_failed() -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+}
+
+} // namespace cotask
@@ -1,17 +1,26 @@
 #pragma once
 
+#include <cotask/arena.hpp>
+#include <cotask/buffer.hpp>
+#include <cotask/file_cache.hpp>
+#include <cotask/dns.hpp>
+
 #include <cassert>
 #include <coroutine>
 #include <vector>
 #include <deque>
+#include <unordered_set>
 
 namespace cotask {
 
 enum struct AsyncIoType {
   Timer,
   FileRead,
-  FileWrite, // TODO
+  FileWrite,
+  FileSystem,
   TcpSocket,
+  UdpSocket,
+  Dns,
 };
 
 struct AsyncIoBase {
@@ -21,15 +30,36 @@ struct AsyncIoBase {
 enum struct FileIoType {
   ReadBuf,
   ReadAll,
+  WriteBuf,
+  Flush,
+};
+
+enum struct FsIoType {
+  ListDir,
+  Stat,
 };
 
 enum struct TcpIoType {
   Accept,
+  AcceptStream,
   Connect,
   Recv,
   RecvAll,
+  RecvPooled,
+  RecvStream,
+  RecvV,
   Send,
   SendAll,
+  SendZeroCopy,
+  SendV,
+  SendFile,
+  UnixAccept,
+  UnixConnect,
+};
+
+enum struct UdpIoType {
+  RecvBatch,
+  SendBatch,
 };
 
 auto net_init() -> void;
@@ -71,6 +101,12 @@ private:
   std::deque<ScheduledTask> tasks;
   std::vector<std::coroutine_handle<>> ended_task;
   std::vector<std::coroutine_handle<>> top_level_tasks;
+  std::unordered_set<void *> detached_tasks; // frame addresses
+
+public:
+  AlignedBufferPool aligned_buffers;
+  FileHandleCache file_handles;
+  DnsCache dns;
 
 public:
   TaskScheduler();
@@ -86,6 +122,16 @@ public:
   template <typename T>
   inline auto schedule_from_sync(Task<T> &&task) -> void;
 
+  // fire and forget: the frame is destroyed as soon as the task ends, not when `execute` returns
+  // (for per connection / per request tasks of long running servers)
+  template <typename T>
+  inline auto schedule_detached(Task<T> &&task) -> void;
+
+  inline auto end_detached(std::coroutine_handle<> cohandle) -> void {
+    detached_tasks.erase(cohandle.address());
+    ended_task.push_back(cohandle);
+  }
+
   inline auto schedule_from_task(ScheduledTask task) -> void {
     tasks.push_back(task);
   }
@@ -101,6 +147,7 @@ struct TaskPromise {
   TaskScheduler &ts;
   bool *outer_is_waiting = nullptr;
   bool is_waiting = false;
+  bool detached = false;
 
   inline explicit TaskPromise(TaskScheduler &ts) : ts{ts} {}
 };
@@ -114,6 +161,18 @@ struct Task<void> {
     template <typename... Args>
     inline promise_type(TaskScheduler &ts, Args...) : TaskPromise{ts} {}
 
+    // the frame goes into the arena of a `ConnectionArena *` argument (or of a socket argument with one attached)
+    template <typename... Args>
+    static inline auto operator new(std::size_t size, TaskScheduler &, const Args &...args) -> void * {
+      return TaskFrame::allocate(size, find_arena(args...));
+    }
+    static inline auto operator new(std::size_t size) -> void * {
+      return TaskFrame::allocate(size, nullptr);
+    }
+    static inline auto operator delete(void *ptr, std::size_t size) -> void {
+      TaskFrame::deallocate(ptr, size);
+    }
+
     inline auto get_return_object() -> Task {
       return Task{coro_handle::from_promise(*this)};
     }
@@ -124,6 +183,9 @@ struct Task<void> {
       if (outer_is_waiting != nullptr) {
         *outer_is_waiting = false;
       }
+      if (detached) {
+        ts.end_detached(coro_handle::from_promise(*this));
+      }
       return {};
     }
     inline auto return_void() -> void {}
@@ -182,6 +244,18 @@ struct Task {
     template <typename... Args>
     inline promise_type(TaskScheduler &ts, Args...) : TaskPromise{ts} {}
 
+    // the frame goes into the arena of a `ConnectionArena *` argument (or of a socket argument with one attached)
+    template <typename... Args>
+    static inline auto operator new(std::size_t size, TaskScheduler &, const Args &...args) -> void * {
+      return TaskFrame::allocate(size, find_arena(args...));
+    }
+    static inline auto operator new(std::size_t size) -> void * {
+      return TaskFrame::allocate(size, nullptr);
+    }
+    static inline auto operator delete(void *ptr, std::size_t size) -> void {
+      TaskFrame::deallocate(ptr, size);
+    }
+
     inline auto get_return_object() -> Task {
       return Task{coro_handle::from_promise(*this)};
     }
@@ -192,6 +266,9 @@ struct Task {
       if (outer_is_waiting != nullptr) {
         *outer_is_waiting = false;
       }
+      if (detached) {
+        ts.end_detached(coro_handle::from_promise(*this));
+      }
       return {};
     }
     inline auto return_value(T value) -> void {
@@ -248,6 +325,12 @@ inline auto TaskScheduler::schedule_from_sync(Task<T> &&task) -> void {
   top_level_tasks.push_back(task.cohandle);
 }
 
+template <typename T>
+inline auto TaskScheduler::schedule_detached(Task<T> &&task) -> void {
+  task.promise.detached = true;
+  detached_tasks.insert(task.cohandle.address());
+}
+
 struct SelfDestruct {
   TaskScheduler &ts;
   std::coroutine_handle<> cohandle;
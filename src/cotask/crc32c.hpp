@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <array>
+
+#if defined(_M_X64) or defined(__x86_64__)
+#define COTASK_CRC32C_SSE42
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(COTASK_CRC32C_SSE42) and (defined(__GNUC__) or defined(__clang__))
+#define COTASK_TARGET_SSE42 __attribute__((target("sse4.2")))
+#else
+#define COTASK_TARGET_SSE42
+#endif
+
+namespace cotask {
+
+enum struct Checksum {
+  None,
+  Crc32c,
+};
+
+namespace crc32c_detail {
+
+// slicing-by-8 tables for the castagnoli polynomial (reflected)
+constexpr auto make_tables() -> std::array<std::array<std::uint32_t, 256>, 8> {
+  auto tables = std::array<std::array<std::uint32_t, 256>, 8>{};
+  for (auto i = std::uint32_t{0}; i < 256; ++i) {
+    auto crc = i;
+    for (auto j = 0; j < 8; ++j) {
+      crc = (crc >> 1) ^ ((crc & 1) != 0 ? 0x82F63B78u : 0u);
+    }
+    tables[0][i] = crc;
+  }
+  for (auto i = std::size_t{0}; i < 256; ++i) {
+    for (auto t = std::size_t{1}; t < 8; ++t) {
+      const auto prev = tables[t - 1][i];
+      tables[t][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+    }
+  }
+  return tables;
+}
+
+inline constexpr auto tables = make_tables();
+
+inline auto update_portable(std::uint32_t crc, const unsigned char *data, std::size_t size) -> std::uint32_t {
+  while (size >= 8) {
+    auto lo = std::uint32_t{};
+    auto hi = std::uint32_t{};
+    std::memcpy(&lo, data, 4); // little endian
+    std::memcpy(&hi, data + 4, 4);
+    lo ^= crc;
+    crc = tables[7][lo & 0xFF] ^ tables[6][(lo >> 8) & 0xFF] ^ tables[5][(lo >> 16) & 0xFF] ^ tables[4][lo >> 24] ^
+          tables[3][hi & 0xFF] ^ tables[2][(hi >> 8) & 0xFF] ^ tables[1][(hi >> 16) & 0xFF] ^ tables[0][hi >> 24];
+    data += 8;
+    size -= 8;
+  }
+  while (size > 0) {
+    crc = (crc >> 8) ^ tables[0][(crc ^ *data) & 0xFF];
+    data += 1;
+    size -= 1;
+  }
+  return crc;
+}
+
+#if defined(COTASK_CRC32C_SSE42)
+COTASK_TARGET_SSE42 inline auto update_sse42(std::uint32_t crc, const unsigned char *data, std::size_t size)
+  -> std::uint32_t {
+  auto crc64 = std::uint64_t{crc};
+  while (size >= 8) {
+    auto word = std::uint64_t{};
+    std::memcpy(&word, data, 8);
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += 8;
+    size -= 8;
+  }
+  crc = static_cast<std::uint32_t>(crc64);
+  while (size > 0) {
+    crc = _mm_crc32_u8(crc, *data);
+    data += 1;
+    size -= 1;
+  }
+  return crc;
+}
+
+inline auto has_sse42() -> bool {
+#if defined(_MSC_VER)
+  int info[4]{};
+  ::__cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+} // namespace crc32c_detail
+
+// incremental crc32c (castagnoli), uses sse4.2 when the cpu supports it
+struct Crc32c {
+  std::uint32_t state = 0xFFFFFFFF;
+
+  inline auto update(std::span<const char> buf) -> void {
+    const auto data = reinterpret_cast<const unsigned char *>(buf.data());
+#if defined(COTASK_CRC32C_SSE42)
+    static const auto use_sse42 = crc32c_detail::has_sse42();
+    if (use_sse42) {
+      state = crc32c_detail::update_sse42(state, data, buf.size());
+      return;
+    }
+#endif
+    state = crc32c_detail::update_portable(state, data, buf.size());
+  }
+
+  [[nodiscard]] inline auto value() const -> std::uint32_t {
+    return ~state;
+  }
+};
+
+[[nodiscard]] inline auto crc32c(std::span<const char> buf) -> std::uint32_t {
+  auto crc = Crc32c{};
+  crc.update(buf);
+  return crc.value();
+}
+
+} // namespace cotask
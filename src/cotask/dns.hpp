@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+namespace cotask {
+
+struct DnsCacheStats {
+  std::uint64_t hits = 0;
+  std::uint64_t negative_hits = 0; // lookups answered by a cached failure
+  std::uint64_t misses = 0;
+  std::uint64_t coalesced = 0; // lookups that joined one already in flight
+  std::uint64_t expirations = 0;
+};
+
+// host name resolution off the event loop (worker pool), cached per host and port (owned by `TaskScheduler`)
+struct DnsCache {
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[144]{};
+  Impl *impl;
+
+public:
+  // getaddrinfo does not report record ttls, cached answers live for these durations
+  std::chrono::seconds ttl{30};
+  std::chrono::seconds negative_ttl{5};
+  std::size_t max_entries = 1024;
+  DnsCacheStats stats;
+
+public:
+  DnsCache();
+  inline DnsCache(const DnsCache &other) = delete;
+  ~DnsCache();
+
+public:
+  [[nodiscard]] auto size() const -> std::size_t;
+
+  // drops the cached answer for the host and port (lookups in flight are kept)
+  auto invalidate(std::string_view host, std::string_view port) -> void;
+
+  // drops all cached answers
+  auto clear() -> void;
+};
+
+} // namespace cotask
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/file.hpp>
+#include <cotask/timer.hpp>
+
+#include <bit>
+#include <span>
+#include <array>
+#include <chrono>
+#include <vector>
+#include <filesystem>
+
+namespace cotask {
+
+struct DurableLog;
+struct DurableLogClose;
+
+struct DurableLogOptions {
+  std::size_t max_batch_bytes = 1024 * 1024;
+  // how long to wait for a batch to fill before writing it (0: write as soon as the previous batch is durable),
+  // a timer wait, rounded up to the os timer resolution
+  std::chrono::microseconds max_batch_delay{0};
+};
+
+struct DurableLogStats {
+  std::uint64_t batches = 0;
+  std::uint64_t records = 0;
+  std::uint64_t bytes = 0;
+  // bucket i counts batches of [2^i, 2^(i+1)) records / bytes
+  std::array<std::uint64_t, 32> batch_records_histogram{};
+  std::array<std::uint64_t, 64> batch_bytes_histogram{};
+
+  inline auto record_batch(std::size_t records, std::size_t bytes) -> void {
+    this->batches += 1;
+    this->records += records;
+    this->bytes += bytes;
+    batch_records_histogram[std::bit_width(records | 1) - 1] += 1;
+    batch_bytes_histogram[std::bit_width(bytes | 1) - 1] += 1;
+  }
+};
+
+struct DurableAppendResult {
+  bool finished = false;
+  bool success = false;
+  std::uint64_t offset = 0; // file offset of the record
+};
+
+// resumes once the record is written and flushed
+struct DurableAppend {
+  friend DurableLog;
+
+public:
+  DurableLog &log;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+  std::uint64_t offset = 0;
+  std::size_t size = 0;
+
+public:
+  DurableAppend(DurableLog *log, std::span<const char> record);
+  inline DurableAppend(const DurableAppend &other) = delete;
+
+public:
+  inline auto io_durable(bool success) -> void {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    this->success = success;
+  }
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> DurableAppendResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .offset = offset,
+    };
+  }
+};
+
+// write ahead log with group commit: concurrent appends are coalesced into one write and one flush per batch
+struct DurableLog {
+public:
+  TaskScheduler &ts;
+  FileWriter writer;
+  DurableLogOptions options;
+  DurableLogStats stats;
+
+  bool success = true;
+  bool closing = false;
+  bool closed = false;
+  bool *writer_is_waiting = nullptr;
+  bool *close_is_waiting = nullptr;
+  TimerSleep *batch_delay = nullptr; // while the writer waits for a batch to fill
+
+  std::uint64_t next_offset = 0;
+  std::vector<char> staged;
+  std::vector<DurableAppend *> staged_appends;
+
+public:
+  inline DurableLog(TaskScheduler &ts, const std::filesystem::path &path, DurableLogOptions options = {})
+      : ts{ts}, writer{ts, path, FileWriteMode::Append}, options{options} {
+    success = writer.is_open();
+    next_offset = writer.size;
+    ts.schedule_from_sync(run(ts, this));
+  }
+
+  inline DurableLog(const DurableLog &other) = delete;
+
+  inline ~DurableLog() {
+    assert(closed and "DurableLog must be closed (co_await log.close()) before it is destroyed");
+  }
+
+public:
+  inline auto append(std::span<const char> record) -> DurableAppend {
+    return {this, record};
+  }
+
+  inline auto close() -> DurableLogClose;
+
+  inline auto wake_writer() -> void {
+    if (writer_is_waiting != nullptr) {
+      *writer_is_waiting = false;
+    }
+  }
+
+private:
+  static inline auto run(TaskScheduler &ts, DurableLog *log) -> Task<void>;
+};
+
+inline DurableAppend::DurableAppend(DurableLog *log, std::span<const char> record) : log{*log}, size{record.size()} {
+  if (log->closing or not log->success) {
+    finished = true;
+    success = false;
+    return;
+  }
+
+  offset = log->next_offset;
+  log->next_offset += record.size();
+  log->staged.insert(log->staged.end(), record.begin(), record.end());
+  log->staged_appends.push_back(this);
+  log->wake_writer();
+  if (log->batch_delay != nullptr and log->staged.size() >= log->options.max_batch_bytes) {
+    // the batch is full, write it now
+    log->batch_delay->cancel();
+  }
+}
+
+// suspends the log writer until there is something to write
+struct DurableLogIdle {
+  DurableLog &log;
+
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return not log.staged_appends.empty() or log.closing;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    log.writer_is_waiting = &cohandle.promise().is_waiting;
+    *log.writer_is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    log.writer_is_waiting = &cohandle.promise().is_waiting;
+    *log.writer_is_waiting = true;
+  }
+
+  inline auto await_resume() const noexcept -> void {
+    log.writer_is_waiting = nullptr;
+  }
+};
+
+// resumes once every appended record is durable and the file is closed
+struct DurableLogClose {
+  DurableLog &log;
+
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return log.closed;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    log.close_is_waiting = &cohandle.promise().is_waiting;
+    *log.close_is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    log.close_is_waiting = &cohandle.promise().is_waiting;
+    *log.close_is_waiting = true;
+  }
+
+  inline auto await_resume() const noexcept -> void {}
+};
+
+inline auto DurableLog::close() -> DurableLogClose {
+  closing = true;
+  wake_writer();
+  if (batch_delay != nullptr) {
+    batch_delay->cancel();
+  }
+  return {*this};
+}
+
+inline auto DurableLog::run(TaskScheduler &ts, DurableLog *log) -> Task<void> {
+  auto batch = std::vector<char>{};
+  auto batch_appends = std::vector<DurableAppend *>{};
+
+  while (true) {
+    if (log->staged_appends.empty()) {
+      if (log->closing) {
+        break;
+      }
+      co_await DurableLogIdle{*log};
+      continue;
+    }
+
+    // give concurrent appends a chance to join the batch (sleeps, a full batch or close ends the wait early)
+    if (log->options.max_batch_delay.count() > 0 and log->staged.size() < log->options.max_batch_bytes and
+        not log->closing) {
+      auto sleep = TimerSleep{ts, log->options.max_batch_delay};
+      log->batch_delay = &sleep;
+      co_await sleep;
+      log->batch_delay = nullptr;
+    }
+
+    // take whole records up to max_batch_bytes (at least one)
+    auto batch_bytes = std::size_t{0};
+    auto batch_count = std::size_t{0};
+    for (const auto append : log->staged_appends) {
+      if (batch_count != 0 and batch_bytes + append->size > log->options.max_batch_bytes) {
+        break;
+      }
+      batch_bytes += append->size;
+      batch_count += 1;
+    }
+    batch.assign(log->staged.begin(), log->staged.begin() + batch_bytes);
+    log->staged.erase(log->staged.begin(), log->staged.begin() + batch_bytes);
+    batch_appends.assign(log->staged_appends.begin(), log->staged_appends.begin() + batch_count);
+    log->staged_appends.erase(log->staged_appends.begin(), log->staged_appends.begin() + batch_count);
+
+    // one write and one flush for the whole batch
+    auto batch_success = log->success;
+    if (batch_success) {
+      auto write_result = co_await log->writer.write(batch, batch_appends.front()->offset);
+      batch_success = write_result.success;
+    }
+    if (batch_success) {
+      auto flush_result = co_await log->writer.flush();
+      batch_success = flush_result.success;
+    }
+    log->success = batch_success;
+    log->stats.record_batch(batch_count, batch_bytes);
+
+    for (const auto append : batch_appends) {
+      append->io_durable(batch_success);
+    }
+  }
+
+  log->writer.close();
+  log->closed = true;
+  if (log->close_is_waiting != nullptr) {
+    *log->close_is_waiting = false;
+  }
+}
+
+} // namespace cotask
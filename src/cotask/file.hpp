@@ -1,20 +1,29 @@
 #pragma once
 
 #include <cotask/cotask.hpp>
+#include <cotask/crc32c.hpp>
 
 #include <span>
 #include <array>
 #include <string>
 #include <filesystem>
+#include <memory>
 
 namespace cotask {
 
 struct FileReader;
+struct FileWriter;
+
+enum struct FileReadMode {
+  Buffered,
+  Direct, // bypass the os file cache
+};
 
 struct FileReadBufResult {
   bool finished = false;
   bool success = false;
   std::span<char> buf;
+  std::uint32_t crc32c = 0; // set when read with `Checksum::Crc32c`
 
   [[nodiscard]] inline auto get_string() const -> std::string {
     return {buf.data(), buf.size()};
@@ -45,8 +54,16 @@ private:
   std::uint32_t bytes_read = 0;
   std::uint64_t offset = 0;
 
+  // aligned range read for unaligned direct reads
+  AlignedBuffer bounce;
+  std::uint64_t bounce_offset = 0;
+
+  Checksum checksum;
+  Crc32c crc;
+
 public:
-  FileReadBuf(TaskScheduler &ts, FileReader *reader, std::span<char> buf, std::uint64_t offset = 0);
+  FileReadBuf(TaskScheduler &ts, FileReader *reader, std::span<char> buf, std::uint64_t offset = 0,
+              Checksum checksum = Checksum::None);
   inline FileReadBuf(const FileReadBuf &other) = delete;
   ~FileReadBuf();
 
@@ -76,6 +93,7 @@ public:
       .finished = finished,
       .success = success,
       .buf = buf,
+      .crc32c = crc.value(),
     };
   }
 };
@@ -84,6 +102,7 @@ struct FileReadAllResult {
   bool finished = false;
   bool success = false;
   std::vector<char> content;
+  std::uint32_t crc32c = 0; // set when read with `Checksum::Crc32c`
 
   [[nodiscard]] inline auto get_string() const -> std::string {
     return {content.data(), content.size()};
@@ -111,12 +130,20 @@ private:
 
   FileReader *reader;
   std::array<char, 500> buf;
+  std::span<char> io_buf;
   std::uint32_t bytes_read = 0;
   std::uint64_t offset = 0;
   std::vector<char> content;
 
+  // aligned buffer for direct reads
+  AlignedBuffer bounce;
+  std::size_t skip = 0;
+
+  Checksum checksum;
+  Crc32c crc;
+
 public:
-  FileReadAll(TaskScheduler &ts, FileReader *reader, std::uint64_t offset = 0);
+  FileReadAll(TaskScheduler &ts, FileReader *reader, std::uint64_t offset = 0, Checksum checksum = Checksum::None);
   inline FileReadAll(const FileReadAll &other) = delete;
   ~FileReadAll();
 
@@ -147,6 +174,7 @@ public:
       .finished = finished,
       .success = success,
       .content = content,
+      .crc32c = crc.value(),
     };
   }
 };
@@ -157,27 +185,229 @@ public:
 
 public:
   struct Impl;
-  alignas(8) std::uint8_t impl_storage[8]{};
+  alignas(8) std::uint8_t impl_storage[16]{};
   Impl *impl;
 
 public:
   TaskScheduler &ts;
   const std::filesystem::path path;
+  const FileReadMode mode;
 
 public:
-  FileReader(TaskScheduler &ts, const std::filesystem::path &path);
+  FileReader(TaskScheduler &ts, const std::filesystem::path &path, FileReadMode mode = FileReadMode::Buffered);
   ~FileReader();
 
 public:
-  inline auto read_buf(std::span<char> buf, std::size_t offset = 0) -> FileReadBuf {
+  inline auto read_buf(std::span<char> buf, std::size_t offset = 0, Checksum checksum = Checksum::None)
+    -> FileReadBuf {
+    return {ts, this, buf, offset, checksum};
+  }
+
+  inline auto read_all(std::size_t offset = 0, Checksum checksum = Checksum::None) -> FileReadAll {
+    return {ts, this, offset, checksum};
+  }
+
+  auto close() -> void;
+};
+
+enum struct FileWriteMode {
+  Append,   // open or create, keep the content
+  Truncate, // create or truncate
+};
+
+struct FileWriteBufResult {
+  bool finished = false;
+  bool success = false;
+  std::size_t bytes_written = 0;
+};
+
+struct FileWriteBuf {
+  friend TaskScheduler;
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[48]{};
+  Impl *impl;
+
+private:
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+  FileWriter *writer;
+  std::span<const char> buf;
+  std::uint32_t bytes_written = 0;
+  std::size_t total_bytes_written = 0;
+  std::uint64_t offset = 0;
+
+public:
+  FileWriteBuf(TaskScheduler &ts, FileWriter *writer, std::span<const char> buf, std::uint64_t offset);
+  inline FileWriteBuf(const FileWriteBuf &other) = delete;
+  ~FileWriteBuf();
+
+public:
+  auto io_request() -> bool;
+  auto io_written(std::uint32_t bytes_written) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+public:
+  inline auto await_ready() -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  [[nodiscard]] inline auto await_resume() const noexcept -> FileWriteBufResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .bytes_written = total_bytes_written,
+    };
+  }
+};
+
+struct FileFlushResult {
+  bool finished = false;
+  bool success = false;
+};
+
+// flushes written data to the device (runs on the worker pool)
+struct FileFlush {
+  friend TaskScheduler;
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[80]{};
+  Impl *impl;
+
+private:
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+  FileWriter *writer;
+
+public:
+  FileFlush(TaskScheduler &ts, FileWriter *writer);
+  inline FileFlush(const FileFlush &other) = delete;
+  ~FileFlush();
+
+public:
+  auto io_flushed(std::uint32_t err_code) -> void;
+
+public:
+  inline auto await_ready() -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  [[nodiscard]] inline auto await_resume() const noexcept -> FileFlushResult {
+    return {
+      .finished = finished,
+      .success = success,
+    };
+  }
+};
+
+struct FileWriter {
+public:
+  const AsyncIoType type = AsyncIoType::FileWrite;
+
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[8]{};
+  Impl *impl;
+
+public:
+  TaskScheduler &ts;
+  const std::filesystem::path path;
+  std::uint64_t size = 0; // end offset of the file including writes in flight
+
+public:
+  FileWriter(TaskScheduler &ts, const std::filesystem::path &path, FileWriteMode mode = FileWriteMode::Append);
+  ~FileWriter();
+
+public:
+  [[nodiscard]] auto is_open() const -> bool;
+
+  inline auto write(std::span<const char> buf, std::uint64_t offset) -> FileWriteBuf {
+    if (offset + buf.size() > size) {
+      size = offset + buf.size();
+    }
     return {ts, this, buf, offset};
   }
 
-  inline auto read_all(std::size_t offset = 0) -> FileReadAll {
-    return {ts, this, offset};
+  inline auto append(std::span<const char> buf) -> FileWriteBuf {
+    return write(buf, size);
+  }
+
+  inline auto flush() -> FileFlush {
+    return {ts, this};
   }
 
   auto close() -> void;
 };
 
+enum struct FileAccessHint {
+  Normal,
+  Sequential,
+  Random,
+};
+
+struct MappedFile {
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[32]{};
+  Impl *impl;
+
+public:
+  std::filesystem::path path; // assigned along with the mapping
+
+public:
+  // maps `size` bytes starting at `offset` (size 0 maps to the end of the file)
+  MappedFile(const std::filesystem::path &path, std::uint64_t offset = 0, std::size_t size = 0,
+             FileAccessHint hint = FileAccessHint::Normal);
+  MappedFile(const MappedFile &other);
+  ~MappedFile();
+
+public:
+  auto operator=(const MappedFile &other) -> MappedFile &;
+
+public:
+  [[nodiscard]] auto is_open() const -> bool;
+  [[nodiscard]] auto data() const -> std::span<const char>;
+  [[nodiscard]] auto read(std::size_t offset, std::size_t size) const -> std::span<const char>;
+
+  // asks the os to page in the range in the background (does not block)
+  auto prefetch(std::size_t offset, std::size_t size) const -> bool;
+
+  // unmaps when the last copy is closed or destroyed
+  auto close() -> void;
+};
+
 } // namespace cotask
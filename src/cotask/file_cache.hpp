@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+namespace cotask {
+
+struct FileHandleEntry;
+
+struct FileHandleCacheStats {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  std::uint64_t evictions = 0;
+  std::uint64_t invalidations = 0;
+};
+
+// LRU cache of open file handles, keyed by path and read mode (owned by `TaskScheduler`)
+struct FileHandleCache {
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[128]{};
+  Impl *impl;
+
+public:
+  std::size_t capacity; // 0 disables caching
+  bool validate_on_hit = true;          // reopen when the file size or last write time changed
+  std::uint64_t validate_interval = 1000; // ms, a handle is checked at most this often on hits (0: every hit)
+  FileHandleCacheStats stats;
+
+public:
+  explicit FileHandleCache(std::size_t capacity = 0);
+  inline FileHandleCache(const FileHandleCache &other) = delete;
+  ~FileHandleCache();
+
+public:
+  [[nodiscard]] inline auto enabled() const -> bool {
+    return capacity != 0;
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t;
+
+  // closes idle handles over the new capacity
+  auto set_capacity(std::size_t capacity) -> void;
+
+  // drops cached handles for the path (leased handles are closed when released)
+  auto invalidate(const std::filesystem::path &path) -> void;
+
+  // drops all cached handles
+  auto clear() -> void;
+};
+
+} // namespace cotask
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+#include <cotask/tcp_stream.hpp>
+
+#include <span>
+#include <array>
+#include <string>
+#include <string_view>
+
+namespace cotask {
+
+// frame: 4 byte little endian payload size, payload
+constexpr auto frame_header_size = std::size_t{4};
+
+[[nodiscard]] inline auto encode_u32(std::uint32_t value) -> std::array<char, 4> {
+  return {
+    static_cast<char>(value & 0xff),
+    static_cast<char>((value >> 8) & 0xff),
+    static_cast<char>((value >> 16) & 0xff),
+    static_cast<char>((value >> 24) & 0xff),
+  };
+}
+
+[[nodiscard]] inline auto decode_u32(std::span<const char> buf) -> std::uint32_t {
+  return static_cast<std::uint32_t>(static_cast<std::uint8_t>(buf[0])) |
+         static_cast<std::uint32_t>(static_cast<std::uint8_t>(buf[1])) << 8 |
+         static_cast<std::uint32_t>(static_cast<std::uint8_t>(buf[2])) << 16 |
+         static_cast<std::uint32_t>(static_cast<std::uint8_t>(buf[3])) << 24;
+}
+
+[[nodiscard]] inline auto encode_u64(std::uint64_t value) -> std::array<char, 8> {
+  const auto low = encode_u32(static_cast<std::uint32_t>(value));
+  const auto high = encode_u32(static_cast<std::uint32_t>(value >> 32));
+  return {low[0], low[1], low[2], low[3], high[0], high[1], high[2], high[3]};
+}
+
+[[nodiscard]] inline auto decode_u64(std::span<const char> buf) -> std::uint64_t {
+  return static_cast<std::uint64_t>(decode_u32(buf)) | static_cast<std::uint64_t>(decode_u32(buf.subspan(4))) << 32;
+}
+
+// appends header and payload, for owned buffers (`TcpWriteQueue`)
+inline auto append_frame(std::string &out, std::span<const char> payload) -> void {
+  const auto header = encode_u32(static_cast<std::uint32_t>(payload.size()));
+  out.append(header.data(), header.size());
+  out.append(payload.data(), payload.size());
+}
+
+struct FrameReaderStats {
+  std::uint64_t frames = 0;
+  std::uint64_t bytes = 0;
+};
+
+// reads frames from a stream, payloads are views into the stream buffer (valid until the next read)
+struct FrameReader {
+public:
+  TaskScheduler &ts;
+  TcpStream &stream;
+  std::size_t max_frame_size; // larger frames fail the read, the stream is out of sync afterwards
+  FrameReaderStats stats;
+
+public:
+  inline FrameReader(TcpStream *stream, std::size_t max_frame_size = 16 * 1024 * 1024)
+      : ts{stream->ts}, stream{*stream}, max_frame_size{max_frame_size} {}
+
+  inline FrameReader(const FrameReader &other) = delete;
+
+public:
+  // `buf` is the payload
+  inline auto next() -> Task<TcpStreamResult> {
+    return next(ts, this);
+  }
+
+private:
+  static inline auto next(TaskScheduler &, FrameReader *reader) -> Task<TcpStreamResult>;
+};
+
+inline auto FrameReader::next(TaskScheduler &, FrameReader *reader) -> Task<TcpStreamResult> {
+  // header and payload are consumed together, the payload is never split by a compaction
+  auto header_result = co_await reader->stream.peek(frame_header_size);
+  if (not header_result.success) {
+    co_return header_result;
+  }
+
+  const auto size = decode_u32(header_result.buf);
+  if (size > reader->max_frame_size) {
+    co_return TcpStreamResult{.finished = true, .success = false, .buf = {}};
+  }
+
+  auto frame_result = co_await reader->stream.read_exact(frame_header_size + size);
+  if (not frame_result.success) {
+    co_return frame_result;
+  }
+
+  reader->stats.frames += 1;
+  reader->stats.bytes += size;
+  co_return TcpStreamResult{.finished = true, .success = true, .buf = frame_result.buf.subspan(frame_header_size)};
+}
+
+} // namespace cotask
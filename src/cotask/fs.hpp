@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+
+#include <span>
+#include <deque>
+#include <vector>
+#include <filesystem>
+
+namespace cotask {
+
+struct OverlappedFsListDir;
+
+struct FileStatInfo {
+  std::filesystem::path path;
+  bool success = false;
+  bool is_directory = false;
+  std::uint64_t size = 0;
+  std::uint64_t last_write_time = 0; // 100ns ticks since 1601-01-01 (UTC)
+};
+
+struct FileStatBatchResult {
+  bool finished = false;
+  bool success = false;
+  std::vector<FileStatInfo> stats;
+};
+
+// stats many files concurrently on the worker pool
+struct FileStatBatch {
+  friend TaskScheduler;
+
+public:
+  const AsyncIoType type = AsyncIoType::FileSystem;
+
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[24]{};
+  Impl *impl;
+
+public:
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+  bool failed = false; // a batch could not be submitted, the others still run
+
+  std::span<const std::filesystem::path> paths;
+  std::vector<FileStatInfo> stats;
+  std::size_t in_flight = 0;
+
+public:
+  FileStatBatch(TaskScheduler &ts, std::span<const std::filesystem::path> paths, std::size_t batch_size = 64);
+  inline FileStatBatch(const FileStatBatch &other) = delete;
+  ~FileStatBatch();
+
+public:
+  auto io_stat() -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> FileStatBatchResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .stats = std::move(stats),
+    };
+  }
+};
+
+struct DirectoryWalkNext;
+struct DirectoryWalkClose;
+
+struct DirectoryWalkResult {
+  bool finished = false;
+  bool success = false;
+  std::vector<FileStatInfo> entries; // empty when the walk is done
+};
+
+// recursively lists a directory tree, many directories are listed concurrently on the worker pool
+struct DirectoryWalker {
+  friend TaskScheduler;
+
+public:
+  const AsyncIoType type = AsyncIoType::FileSystem;
+
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[24]{};
+  Impl *impl;
+
+public:
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+  bool success = true; // false: the root could not be listed or a listing could not be submitted
+  bool closing = false;
+  bool *close_is_waiting = nullptr;
+
+  const std::size_t max_in_flight;
+  std::size_t in_flight = 0;
+  std::deque<std::filesystem::path> pending_dirs;
+  std::deque<std::vector<FileStatInfo>> ready_batches;
+
+public:
+  DirectoryWalker(TaskScheduler &ts, const std::filesystem::path &root, std::size_t max_in_flight = 16);
+  inline DirectoryWalker(const DirectoryWalker &other) = delete;
+  ~DirectoryWalker();
+
+public:
+  [[nodiscard]] inline auto done() const -> bool {
+    return ready_batches.empty() and pending_dirs.empty() and in_flight == 0;
+  }
+
+  // returns the next batch of entries (one directory per batch)
+  inline auto next() -> DirectoryWalkNext;
+
+  // stops the walk and waits for listings in flight, must be awaited when the walk is stopped early
+  inline auto close() -> DirectoryWalkClose;
+
+public:
+  auto io_request() -> bool;
+  auto io_listed(OverlappedFsListDir *ovex) -> void;
+};
+
+struct DirectoryWalkNext {
+  DirectoryWalker &walker;
+
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return not walker.ready_batches.empty() or walker.done() or not walker.success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    walker.is_waiting = &cohandle.promise().is_waiting;
+    *walker.is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    walker.is_waiting = &cohandle.promise().is_waiting;
+    *walker.is_waiting = true;
+  }
+
+  inline auto await_resume() -> DirectoryWalkResult {
+    walker.is_waiting = nullptr;
+    if (walker.ready_batches.empty()) {
+      return {
+        .finished = true,
+        .success = walker.success,
+        .entries = {},
+      };
+    }
+
+    auto entries = std::move(walker.ready_batches.front());
+    walker.ready_batches.pop_front();
+    return {
+      .finished = true,
+      .success = walker.success,
+      .entries = std::move(entries),
+    };
+  }
+};
+
+// resumes once no listing of the walker is in flight
+struct DirectoryWalkClose {
+  DirectoryWalker &walker;
+
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return walker.in_flight == 0;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    walker.close_is_waiting = &cohandle.promise().is_waiting;
+    *walker.close_is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    walker.close_is_waiting = &cohandle.promise().is_waiting;
+    *walker.close_is_waiting = true;
+  }
+
+  inline auto await_resume() const noexcept -> void {
+    walker.close_is_waiting = nullptr;
+  }
+};
+
+inline auto DirectoryWalker::next() -> DirectoryWalkNext {
+  return {*this};
+}
+
+inline auto DirectoryWalker::close() -> DirectoryWalkClose {
+  closing = true;
+  pending_dirs.clear();
+  ready_batches.clear();
+  return {*this};
+}
+
+} // namespace cotask
@@ -0,0 +1,412 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+#include <cotask/tcp_stream.hpp>
+
+#include <span>
+#include <array>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <functional>
+#include <string_view>
+
+namespace cotask::http {
+
+constexpr auto max_headers = std::size_t{32};
+
+struct Header {
+  std::string_view name;
+  std::string_view value;
+};
+
+[[nodiscard]] inline auto iequals(std::string_view a, std::string_view b) -> bool {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (auto i = std::size_t{0}; i < a.size(); ++i) {
+    auto ca = a[i];
+    auto cb = b[i];
+    ca = ca >= 'A' and ca <= 'Z' ? static_cast<char>(ca + ('a' - 'A')) : ca;
+    cb = cb >= 'A' and cb <= 'Z' ? static_cast<char>(cb + ('a' - 'A')) : cb;
+    if (ca != cb) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// true when the comma separated `list` contains `token` (case insensitive)
+[[nodiscard]] inline auto has_token(std::string_view list, std::string_view token) -> bool {
+  while (not list.empty()) {
+    const auto comma = list.find(',');
+    auto item = list.substr(0, comma);
+    while (not item.empty() and (item.front() == ' ' or item.front() == '\t')) {
+      item.remove_prefix(1);
+    }
+    while (not item.empty() and (item.back() == ' ' or item.back() == '\t')) {
+      item.remove_suffix(1);
+    }
+    if (iequals(item, token)) {
+      return true;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    list.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+// views into the receive buffer, valid until the request is answered
+struct Request {
+  std::string_view method;
+  std::string_view target;
+  int version_minor = 1; // HTTP/1.x
+  std::array<Header, max_headers> headers{};
+  std::size_t header_count = 0;
+  std::string_view body;
+  bool keep_alive = true;
+  std::size_t size = 0; // head + body bytes
+
+  [[nodiscard]] inline auto get_headers() const -> std::span<const Header> {
+    return {headers.data(), header_count};
+  }
+
+  // first header with the name (case insensitive), empty when missing
+  [[nodiscard]] inline auto header(std::string_view name) const -> std::string_view {
+    for (const auto &header : get_headers()) {
+      if (iequals(header.name, name)) {
+        return header.value;
+      }
+    }
+    return {};
+  }
+};
+
+enum struct ParseStatus {
+  Complete,
+  Incomplete,
+  BadRequest,
+  Unsupported, // chunked request bodies
+};
+
+// incremental HTTP/1.1 request parser, never allocates
+struct RequestParser {
+  // bytes of the current request already searched for the end of the head
+  std::size_t scanned = 0;
+
+  inline auto reset() -> void {
+    scanned = 0;
+  }
+
+  // `buf` starts at the current request, `request` views into it
+  inline auto parse(std::string_view buf, Request &request) -> ParseStatus {
+    // only bytes that arrived since the last call are searched
+    const auto head_end = buf.find("\r\n\r\n", scanned < 3 ? 0 : scanned - 3);
+    if (head_end == std::string_view::npos) {
+      scanned = buf.size();
+      return ParseStatus::Incomplete;
+    }
+    scanned = head_end;
+
+    const auto head_size = head_end + 4;
+    auto content_length = std::size_t{0};
+    if (const auto status = parse_head(buf.substr(0, head_end + 2), request, content_length);
+        status != ParseStatus::Complete) {
+      return status;
+    }
+
+    if (buf.size() - head_size < content_length) {
+      return ParseStatus::Incomplete;
+    }
+    request.body = buf.substr(head_size, content_length);
+    request.size = head_size + content_length;
+    return ParseStatus::Complete;
+  }
+
+private:
+  static inline auto parse_head(std::string_view head, Request &request, std::size_t &content_length)
+    -> ParseStatus {
+    // request line: method SP target SP HTTP/1.x CRLF
+    const auto line_end = head.find("\r\n");
+    auto line = head.substr(0, line_end);
+    head.remove_prefix(line_end + 2);
+
+    const auto method_end = line.find(' ');
+    if (method_end == 0 or method_end == std::string_view::npos) {
+      return ParseStatus::BadRequest;
+    }
+    request.method = line.substr(0, method_end);
+    line.remove_prefix(method_end + 1);
+
+    const auto target_end = line.find(' ');
+    if (target_end == 0 or target_end == std::string_view::npos) {
+      return ParseStatus::BadRequest;
+    }
+    request.target = line.substr(0, target_end);
+    line.remove_prefix(target_end + 1);
+
+    if (line.size() != 8 or not line.starts_with("HTTP/1.") or line[7] < '0' or line[7] > '9') {
+      return ParseStatus::BadRequest;
+    }
+    request.version_minor = line[7] - '0';
+    request.keep_alive = request.version_minor >= 1;
+
+    // header lines: name ":" OWS value OWS CRLF
+    request.header_count = 0;
+    auto chunked = false;
+    auto has_content_length = false;
+    content_length = 0;
+    while (not head.empty()) {
+      const auto header_end = head.find("\r\n");
+      auto header_line = head.substr(0, header_end);
+      head.remove_prefix(header_end + 2);
+
+      const auto colon = header_line.find(':');
+      if (colon == 0 or colon == std::string_view::npos or request.header_count == max_headers) {
+        return ParseStatus::BadRequest;
+      }
+      const auto name = header_line.substr(0, colon);
+      if (name.find_first_of(" \t") != std::string_view::npos) {
+        // also rejects obsolete line folding
+        return ParseStatus::BadRequest;
+      }
+      auto value = header_line.substr(colon + 1);
+      while (not value.empty() and (value.front() == ' ' or value.front() == '\t')) {
+        value.remove_prefix(1);
+      }
+      while (not value.empty() and (value.back() == ' ' or value.back() == '\t')) {
+        value.remove_suffix(1);
+      }
+      request.headers[request.header_count] = {name, value};
+      request.header_count += 1;
+
+      if (iequals(name, "content-length")) {
+        auto length = std::size_t{0};
+        const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+        if (ec != std::errc{} or ptr != value.data() + value.size()) {
+          return ParseStatus::BadRequest;
+        }
+        // differing lengths would let a proxy and this server frame the body differently (RFC 9112 6.3)
+        if (has_content_length and length != content_length) {
+          return ParseStatus::BadRequest;
+        }
+        has_content_length = true;
+        content_length = length;
+      } else if (iequals(name, "transfer-encoding")) {
+        chunked = true;
+      } else if (iequals(name, "connection")) {
+        if (has_token(value, "close")) {
+          request.keep_alive = false;
+        } else if (has_token(value, "keep-alive")) {
+          request.keep_alive = true;
+        }
+      }
+    }
+
+    return chunked ? ParseStatus::Unsupported : ParseStatus::Complete;
+  }
+};
+
+[[nodiscard]] inline auto status_reason(int status) -> std::string_view {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 201:
+    return "Created";
+  case 204:
+    return "No Content";
+  case 301:
+    return "Moved Permanently";
+  case 304:
+    return "Not Modified";
+  case 400:
+    return "Bad Request";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 413:
+    return "Content Too Large";
+  case 500:
+    return "Internal Server Error";
+  case 501:
+    return "Not Implemented";
+  case 503:
+    return "Service Unavailable";
+  default:
+    return "Unknown";
+  }
+}
+
+// header names / values and `body` are views, they must stay valid until the response is sent
+// (literals, views into the request or `body_storage`)
+struct Response {
+  int status = 200;
+  std::array<Header, max_headers> headers{};
+  std::size_t header_count = 0;
+  std::string_view body;
+  std::string body_storage;
+  bool close = false; // close the connection after this response
+
+  inline auto add_header(std::string_view name, std::string_view value) -> bool {
+    if (header_count == max_headers) {
+      return false;
+    }
+    headers[header_count] = {name, value};
+    header_count += 1;
+    return true;
+  }
+
+  // owned body
+  inline auto set_body(std::string buf) -> void {
+    body_storage = std::move(buf);
+    body = body_storage;
+  }
+
+  // keeps the capacity of `body_storage`
+  inline auto reset() -> void {
+    status = 200;
+    header_count = 0;
+    body = {};
+    body_storage.clear();
+    close = false;
+  }
+
+  // status line and headers, Content-Length and Connection are added here
+  inline auto write_head(std::string &out, int version_minor) const -> void {
+    char digits[24];
+
+    out += "HTTP/1.1 ";
+    auto end = std::to_chars(digits, digits + sizeof(digits), status).ptr;
+    out.append(digits, end);
+    out += ' ';
+    out += status_reason(status);
+    out += "\r\n";
+
+    for (auto i = std::size_t{0}; i < header_count; ++i) {
+      out += headers[i].name;
+      out += ": ";
+      out += headers[i].value;
+      out += "\r\n";
+    }
+
+    out += "Content-Length: ";
+    end = std::to_chars(digits, digits + sizeof(digits), body.size()).ptr;
+    out.append(digits, end);
+    out += "\r\n";
+
+    if (close) {
+      out += "Connection: close\r\n";
+    } else if (version_minor == 0) {
+      out += "Connection: keep-alive\r\n";
+    }
+    out += "\r\n";
+  }
+};
+
+struct ServerOptions {
+  std::size_t initial_buffer_size = 16 * 1024;
+  std::size_t max_request_size = 1024 * 1024; // head + body, larger requests are answered with 413
+  std::size_t max_pipeline = 16;              // pipelined requests answered by one vectored send
+  std::uint64_t idle_timeout = 0;             // ms, 0: wait forever
+};
+
+using Handler = std::function<void(const Request &, Response &)>;
+
+// serves one connection (keep alive, pipelining) until either side closes it, closes the socket
+inline auto serve(TaskScheduler &ts, TcpSocket *sock, Handler handler, ServerOptions options = {}) -> Task<void> {
+  auto stream = TcpStream{sock, options.initial_buffer_size, options.max_request_size, options.idle_timeout};
+  auto parser = RequestParser{};
+  auto request = Request{};
+  auto responses = std::vector<Response>(options.max_pipeline == 0 ? 1 : options.max_pipeline);
+  auto versions = std::vector<int>(responses.size());
+  auto heads = std::string{};
+  auto head_ends = std::vector<std::size_t>{};
+  auto bufs = std::vector<std::span<const char>>{};
+  auto open = true;
+
+  while (open) {
+    // answer every complete request that is buffered
+    const auto buffered = std::string_view{stream.buffered().data(), stream.buffered().size()};
+    auto consumed = std::size_t{0};
+    auto count = std::size_t{0};
+    auto status = ParseStatus::Incomplete;
+    while (open and count < responses.size()) {
+      status = parser.parse(buffered.substr(consumed), request);
+      if (status != ParseStatus::Complete) {
+        break;
+      }
+      parser.reset();
+
+      auto &response = responses[count];
+      response.reset();
+      handler(request, response);
+      response.close = response.close or not request.keep_alive;
+      versions[count] = request.version_minor;
+      consumed += request.size;
+      count += 1;
+      open = not response.close;
+    }
+
+    if (status == ParseStatus::BadRequest or status == ParseStatus::Unsupported) {
+      // answered after the requests before it, then closed
+      auto &response = responses[count];
+      response.reset();
+      response.status = status == ParseStatus::BadRequest ? 400 : 501;
+      response.close = true;
+      versions[count] = 1;
+      count += 1;
+      open = false;
+    }
+
+    if (count == 0) {
+      // receive more of the current request
+      auto fill_result = co_await TcpStream::fill(ts, &stream, buffered.size() + 1);
+      if (fill_result.success) {
+        continue;
+      }
+      if (not fill_result.finished or stream.eof) {
+        // timeout or closed
+        break;
+      }
+      responses[0].reset();
+      responses[0].status = 413;
+      responses[0].close = true;
+      versions[0] = 1;
+      count = 1;
+      open = false;
+    }
+
+    // one vectored send for all answers: head, body, head, body, ...
+    heads.clear();
+    head_ends.clear();
+    for (auto i = std::size_t{0}; i < count; ++i) {
+      responses[i].write_head(heads, versions[i]);
+      head_ends.push_back(heads.size());
+    }
+    bufs.clear();
+    for (auto i = std::size_t{0}; i < count; ++i) {
+      const auto head_begin = i == 0 ? 0 : head_ends[i - 1];
+      bufs.emplace_back(heads.data() + head_begin, head_ends[i] - head_begin);
+      if (not responses[i].body.empty()) {
+        bufs.emplace_back(responses[i].body.data(), responses[i].body.size());
+      }
+    }
+    auto send_result = co_await TcpSendAllV{sock, bufs};
+    if (not send_result.success) {
+      break;
+    }
+
+    // the requests were only views into the buffer, release them after they are answered
+    stream.consume(consumed);
+  }
+
+  sock->close();
+}
+
+} // namespace cotask::http
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+#include <cotask/file.hpp>
+
+#include <new>
+#include <span>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+namespace cotask {
+
+// storage of `IoBuf` segments and `SharedBuffer`s, count and bytes in one allocation
+// (the count is not atomic, a buffer stays within one scheduler)
+struct IoBufBlock {
+  std::size_t refs;
+  std::size_t capacity;
+
+  [[nodiscard]] static inline auto create(std::size_t capacity) -> IoBufBlock * {
+    auto memory = ::operator new(sizeof(IoBufBlock) + capacity);
+    return ::new (memory) IoBufBlock{.refs = 1, .capacity = capacity};
+  }
+
+  [[nodiscard]] inline auto data() -> char * {
+    return reinterpret_cast<char *>(this + 1);
+  }
+};
+
+// a range of a block, copies share the block
+struct IoBufSegment {
+  IoBufBlock *block = nullptr;
+  std::size_t offset = 0;
+  std::size_t size = 0;
+
+  inline IoBufSegment() = default;
+
+  // takes over the reference of `block`
+  inline IoBufSegment(IoBufBlock *block, std::size_t offset, std::size_t size)
+      : block{block}, offset{offset}, size{size} {}
+
+  inline IoBufSegment(const IoBufSegment &other) : block{other.block}, offset{other.offset}, size{other.size} {
+    if (block != nullptr) {
+      block->refs += 1;
+    }
+  }
+
+  inline IoBufSegment(IoBufSegment &&other) noexcept
+      : block{std::exchange(other.block, nullptr)}, offset{std::exchange(other.offset, 0)},
+        size{std::exchange(other.size, 0)} {}
+
+  inline auto operator=(const IoBufSegment &other) -> IoBufSegment & {
+    if (this != &other) {
+      release();
+      block = other.block;
+      offset = other.offset;
+      size = other.size;
+      if (block != nullptr) {
+        block->refs += 1;
+      }
+    }
+    return *this;
+  }
+
+  inline auto operator=(IoBufSegment &&other) noexcept -> IoBufSegment & {
+    if (this != &other) {
+      release();
+      block = std::exchange(other.block, nullptr);
+      offset = std::exchange(other.offset, 0);
+      size = std::exchange(other.size, 0);
+    }
+    return *this;
+  }
+
+  inline ~IoBufSegment() {
+    release();
+  }
+
+  [[nodiscard]] inline auto get() const -> std::span<const char> {
+    return {block->data() + offset, size};
+  }
+
+  // only a block nobody else views may be written around the segment
+  [[nodiscard]] inline auto unique() const -> bool {
+    return block != nullptr and block->refs == 1;
+  }
+
+  [[nodiscard]] inline auto headroom() const -> std::size_t {
+    return unique() ? offset : 0;
+  }
+
+  [[nodiscard]] inline auto tailroom() const -> std::size_t {
+    return unique() ? block->capacity - offset - size : 0;
+  }
+
+  inline auto release() -> void {
+    if (block != nullptr) {
+      block->refs -= 1;
+      if (block->refs == 0) {
+        ::operator delete(block);
+      }
+      block = nullptr;
+    }
+  }
+};
+
+// chain of reference counted segments: copies, slices and appends share the bytes instead of copying them
+struct IoBuf {
+  std::vector<IoBufSegment> segments;
+  std::size_t total = 0;
+
+  // empty buffer with writable space, `headroom` bytes are kept in front for `prepend`
+  [[nodiscard]] static inline auto create(std::size_t capacity, std::size_t headroom = 0) -> IoBuf {
+    auto iobuf = IoBuf{};
+    iobuf.segments.emplace_back(IoBufBlock::create(headroom + capacity), headroom, 0);
+    return iobuf;
+  }
+
+  [[nodiscard]] static inline auto copy_from(std::span<const char> buf, std::size_t headroom = 0) -> IoBuf {
+    auto iobuf = create(buf.size(), headroom);
+    iobuf.append(buf);
+    return iobuf;
+  }
+
+  [[nodiscard]] inline auto size() const -> std::size_t {
+    return total;
+  }
+
+  [[nodiscard]] inline auto empty() const -> bool {
+    return total == 0;
+  }
+
+  // gather list for vectored sends and writes
+  inline auto append_to(std::vector<std::span<const char>> &bufs) const -> void {
+    for (const auto &segment : segments) {
+      if (segment.size != 0) {
+        bufs.push_back(segment.get());
+      }
+    }
+  }
+
+  // writable space after the last byte, at least `min_size` bytes (a new block of `block_size` when there is less)
+  inline auto reserve_tail(std::size_t min_size, std::size_t block_size = 16 * 1024) -> std::span<char> {
+    if (segments.empty() or segments.back().tailroom() < min_size) {
+      segments.emplace_back(IoBufBlock::create(std::max(min_size, block_size)), 0, 0);
+    }
+    auto &last = segments.back();
+    return {last.block->data() + last.offset + last.size, last.tailroom()};
+  }
+
+  // `size` bytes written into the span of `reserve_tail` become part of the buffer
+  inline auto commit(std::size_t size) -> void {
+    segments.back().size += size;
+    total += size;
+  }
+
+  // copies into the tail room, then into a new block
+  inline auto append(std::span<const char> buf) -> void {
+    if (buf.empty()) {
+      return;
+    }
+    auto tail = reserve_tail(buf.size(), buf.size());
+    std::memcpy(tail.data(), buf.data(), buf.size());
+    commit(buf.size());
+  }
+
+  // shares the segments of `other`
+  inline auto append(const IoBuf &other) -> void {
+    for (const auto &segment : other.segments) {
+      if (segment.size != 0) {
+        segments.push_back(segment);
+      }
+    }
+    total += other.total;
+  }
+
+  inline auto append(IoBuf &&other) -> void {
+    for (auto &segment : other.segments) {
+      if (segment.size != 0) {
+        segments.push_back(std::move(segment));
+      }
+    }
+    total += other.total;
+    other.clear();
+  }
+
+  // copies into the head room (headers in front of a payload), a new segment when there is not enough
+  inline auto prepend(std::span<const char> buf) -> void {
+    if (buf.empty()) {
+      return;
+    }
+    if (not segments.empty() and segments.front().headroom() >= buf.size()) {
+      auto &first = segments.front();
+      first.offset -= buf.size();
+      first.size += buf.size();
+      std::memcpy(first.block->data() + first.offset, buf.data(), buf.size());
+    } else {
+      auto segment = IoBufSegment{IoBufBlock::create(buf.size()), 0, buf.size()};
+      std::memcpy(segment.block->data(), buf.data(), buf.size());
+      segments.insert(segments.begin(), std::move(segment));
+    }
+    total += buf.size();
+  }
+
+  // shares the bytes in [offset, offset + size)
+  [[nodiscard]] inline auto slice(std::size_t offset, std::size_t size) const -> IoBuf {
+    auto iobuf = IoBuf{};
+    for (const auto &segment : segments) {
+      if (size == 0) {
+        break;
+      }
+      if (offset >= segment.size) {
+        offset -= segment.size;
+        continue;
+      }
+      const auto take = std::min(segment.size - offset, size);
+      auto part = segment;
+      part.offset += offset;
+      part.size = take;
+      iobuf.segments.push_back(std::move(part));
+      iobuf.total += take;
+      size -= take;
+      offset = 0;
+    }
+    return iobuf;
+  }
+
+  inline auto trim_front(std::size_t size) -> void {
+    size = std::min(size, total);
+    total -= size;
+    auto drop = std::size_t{0};
+    while (size != 0) {
+      auto &segment = segments[drop];
+      const auto take = std::min(segment.size, size);
+      segment.offset += take;
+      segment.size -= take;
+      size -= take;
+      if (segment.size == 0) {
+        drop += 1;
+      }
+    }
+    segments.erase(segments.begin(), segments.begin() + static_cast<std::ptrdiff_t>(drop));
+  }
+
+  inline auto trim_back(std::size_t size) -> void {
+    size = std::min(size, total);
+    total -= size;
+    while (size != 0) {
+      auto &segment = segments.back();
+      const auto take = std::min(segment.size, size);
+      segment.size -= take;
+      size -= take;
+      if (segment.size == 0 and size != 0) {
+        segments.pop_back();
+      }
+    }
+  }
+
+  // one contiguous span, copies only when the bytes are spread over several segments
+  inline auto coalesce() -> std::span<const char> {
+    auto count = std::size_t{0};
+    for (const auto &segment : segments) {
+      count += segment.size != 0 ? 1 : 0;
+    }
+    if (count > 1) {
+      auto segment = IoBufSegment{IoBufBlock::create(total), 0, 0};
+      for (const auto &part : segments) {
+        if (part.size != 0) {
+          std::memcpy(segment.block->data() + segment.size, part.get().data(), part.size);
+          segment.size += part.size;
+        }
+      }
+      segments.clear();
+      segments.push_back(std::move(segment));
+    }
+    for (const auto &segment : segments) {
+      if (segment.size != 0) {
+        return segment.get();
+      }
+    }
+    return {};
+  }
+
+  inline auto clear() -> void {
+    segments.clear();
+    total = 0;
+  }
+};
+
+struct IoBufResult {
+  bool finished = false;
+  bool success = false;
+  std::size_t bytes = 0; // received / read / sent / written
+};
+
+// receives once and appends to `buf`, into its tail room when at least half a block is left
+inline auto recv_iobuf(TaskScheduler &, TcpSocket *sock, IoBuf *buf, std::size_t block_size = 16 * 1024,
+                       std::uint64_t timeout = 0) -> Task<IoBufResult> {
+  auto tail = buf->reserve_tail(block_size / 2 + 1, block_size);
+  auto recv_result = co_await TcpRecv{sock, tail, timeout};
+  if (recv_result.success) {
+    buf->commit(recv_result.buf.size());
+  }
+  co_return IoBufResult{
+    .finished = recv_result.finished,
+    .success = recv_result.success,
+    .bytes = recv_result.buf.size(),
+  };
+}
+
+// sends every segment with one vectored send, `buf` keeps the bytes alive until the send completed
+inline auto send_iobuf(TaskScheduler &, TcpSocket *sock, IoBuf buf) -> Task<IoBufResult> {
+  auto bufs = std::vector<std::span<const char>>{};
+  bufs.reserve(buf.segments.size());
+  buf.append_to(bufs);
+  auto send_result = co_await TcpSendAllV{sock, bufs};
+  co_return IoBufResult{
+    .finished = send_result.finished,
+    .success = send_result.success,
+    .bytes = static_cast<std::size_t>(send_result.bytes_sent),
+  };
+}
+
+// reads up to `size` bytes at `offset` and appends them to `buf`
+inline auto read_iobuf(TaskScheduler &, FileReader *reader, IoBuf *buf, std::size_t size, std::uint64_t offset = 0)
+  -> Task<IoBufResult> {
+  auto tail = buf->reserve_tail(size, size).first(size);
+  auto read_result = co_await reader->read_buf(tail, offset);
+  if (read_result.success) {
+    buf->commit(read_result.buf.size());
+  }
+  co_return IoBufResult{
+    .finished = read_result.finished,
+    .success = read_result.success,
+    .bytes = read_result.buf.size(),
+  };
+}
+
+// writes the segments back to back at `offset`, `buf` keeps the bytes alive until every write completed
+inline auto write_iobuf(TaskScheduler &, FileWriter *writer, IoBuf buf, std::uint64_t offset) -> Task<IoBufResult> {
+  auto result = IoBufResult{.finished = true, .success = true};
+  for (const auto &segment : buf.segments) {
+    if (segment.size == 0) {
+      continue;
+    }
+    auto write_result = co_await writer->write(segment.get(), offset + result.bytes);
+    result.bytes += write_result.bytes_written;
+    if (not write_result.success) {
+      result.success = false;
+      break;
+    }
+  }
+  co_return result;
+}
+
+// the range at the end of the file is reserved when called, appends land in call order
+inline auto append_iobuf(TaskScheduler &ts, FileWriter *writer, IoBuf buf) -> Task<IoBufResult> {
+  const auto offset = writer->size;
+  writer->size += buf.size();
+  return write_iobuf(ts, writer, std::move(buf), offset);
+}
+
+} // namespace cotask
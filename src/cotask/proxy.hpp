@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+#include <cotask/timer.hpp>
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <optional>
+
+namespace cotask {
+
+struct TcpProxyOptions {
+  std::size_t buffer_size = 64 * 1024; // per buffer, two per direction
+  std::uint64_t idle_timeout = 0;      // ms without data in either direction, 0: wait forever
+  bool zero_copy = true;               // send from the relay buffers without copying into the socket send buffer
+};
+
+struct TcpProxyResult {
+  bool success = false;      // false: a send failed or the relay went idle
+  bool idle_timeout = false;
+  std::uint64_t bytes_a_to_b = 0;
+  std::uint64_t bytes_b_to_a = 0;
+};
+
+// relays two connected sockets in both directions
+struct TcpProxy {
+public:
+  TaskScheduler &ts;
+  TcpSocket &a;
+  TcpSocket &b;
+  TcpProxyOptions options;
+  TcpProxyResult result;
+
+  bool closed = false;
+  std::chrono::steady_clock::time_point last_activity = std::chrono::steady_clock::now();
+  TimerSleep *idle_sleep = nullptr; // sleep of the idle watch, cancelled when the relay ends
+
+public:
+  inline TcpProxy(TcpSocket *a, TcpSocket *b, TcpProxyOptions options = {})
+      : ts{a->ts}, a{*a}, b{*b}, options{options} {}
+
+  inline TcpProxy(const TcpProxy &other) = delete;
+
+public:
+  // finishes when both directions ended (a close from the sender is passed on as a half close),
+  // both sockets are closed afterwards
+  inline auto run() -> Task<TcpProxyResult> {
+    return run(ts, this);
+  }
+
+  // ends both directions, their pending receives fail
+  inline auto abort() -> void {
+    if (closed) {
+      return;
+    }
+    closed = true;
+    a.close();
+    b.close();
+  }
+
+private:
+  static inline auto run(TaskScheduler &ts, TcpProxy *proxy) -> Task<TcpProxyResult>;
+  static inline auto relay(TaskScheduler &ts, TcpProxy *proxy, TcpSocket *from, TcpSocket *to,
+                           std::uint64_t *bytes) -> Task<void>;
+  static inline auto watch_idle(TaskScheduler &ts, TcpProxy *proxy) -> Task<void>;
+};
+
+inline auto TcpProxy::run(TaskScheduler &ts, TcpProxy *proxy) -> Task<TcpProxyResult> {
+  proxy->result.success = true;
+
+  // both directions run concurrently from here
+  auto a_to_b = relay(ts, proxy, &proxy->a, &proxy->b, &proxy->result.bytes_a_to_b);
+  auto b_to_a = relay(ts, proxy, &proxy->b, &proxy->a, &proxy->result.bytes_b_to_a);
+  auto idle = std::optional<Task<void>>{};
+  if (proxy->options.idle_timeout > 0) {
+    idle.emplace(watch_idle(ts, proxy));
+  }
+  co_await a_to_b;
+  co_await b_to_a;
+
+  proxy->abort();
+  if (idle.has_value()) {
+    if (proxy->idle_sleep != nullptr) {
+      proxy->idle_sleep->cancel();
+    }
+    auto &idle_task = *idle;
+    co_await idle_task;
+  }
+  co_return proxy->result;
+}
+
+inline auto TcpProxy::watch_idle(TaskScheduler &ts, TcpProxy *proxy) -> Task<void> {
+  // one timer for the whole relay, receives never time out (a cancelled receive must not be re-armed)
+  const auto idle_timeout = std::chrono::milliseconds{proxy->options.idle_timeout};
+  while (not proxy->closed) {
+    const auto idle = std::chrono::steady_clock::now() - proxy->last_activity;
+    if (idle >= idle_timeout) {
+      proxy->result.idle_timeout = true;
+      proxy->result.success = false;
+      proxy->abort();
+      break;
+    }
+
+    auto sleep = TimerSleep{ts, std::chrono::duration_cast<std::chrono::microseconds>(idle_timeout - idle)};
+    proxy->idle_sleep = &sleep;
+    co_await sleep;
+    proxy->idle_sleep = nullptr;
+  }
+}
+
+inline auto TcpProxy::relay(TaskScheduler &ts, TcpProxy *proxy, TcpSocket *from, TcpSocket *to,
+                            std::uint64_t *bytes) -> Task<void> {
+  const auto buffer_size = proxy->options.buffer_size == 0 ? std::size_t{4096} : proxy->options.buffer_size;
+  const auto zero_copy_threshold = proxy->options.zero_copy ? 0 : std::numeric_limits<std::size_t>::max();
+
+  // double buffered: the next chunk is received while the previous one is sent
+  auto leases = std::array<AlignedBuffer, 2>{
+    ts.aligned_buffers.acquire(buffer_size),
+    ts.aligned_buffers.acquire(buffer_size),
+  };
+  auto current = std::size_t{0};
+  auto send = std::optional<TcpSendZeroCopy>{};
+  auto sender_closed = false;
+
+  while (not proxy->closed) {
+    auto recv_result = co_await TcpRecv{from, leases[current].buf.first(buffer_size)};
+
+    if (send.has_value()) {
+      auto &pending_send = *send;
+      auto send_result = co_await pending_send;
+      send.reset();
+      if (not send_result.success) {
+        proxy->result.success = false;
+        break;
+      }
+    }
+
+    if (not recv_result.success) {
+      // closed by the sender, or aborted (idle, the other direction failed)
+      sender_closed = not proxy->closed;
+      break;
+    }
+
+    proxy->last_activity = std::chrono::steady_clock::now();
+    *bytes += recv_result.buf.size();
+    send.emplace(to, recv_result.buf, zero_copy_threshold);
+    current ^= 1;
+  }
+
+  if (send.has_value()) {
+    auto &pending_send = *send;
+    auto send_result = co_await pending_send;
+    if (not send_result.success) {
+      proxy->result.success = false;
+      sender_closed = false;
+    }
+  }
+
+  if (sender_closed and not proxy->closed) {
+    // pass the close on, the other direction keeps running
+    to->shutdown_send();
+  } else {
+    proxy->abort();
+  }
+}
+
+// `co_await tcp_proxy(ts, &a, &b)`
+inline auto tcp_proxy(TaskScheduler &, TcpSocket *a, TcpSocket *b, TcpProxyOptions options = {})
+  -> Task<TcpProxyResult> {
+  auto proxy = TcpProxy{a, b, options};
+  co_return co_await proxy.run();
+}
+
+} // namespace cotask
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+#include <cotask/frame.hpp>
+#include <cotask/tcp_stream.hpp>
+#include <cotask/write_queue.hpp>
+
+#include <span>
+#include <string>
+#include <utility>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+
+namespace cotask {
+
+struct RpcClient;
+struct RpcServerConnection;
+
+// frame payloads
+//   request: u64 id, u32 method, body
+//   reply:   u64 id, u32 status, body
+constexpr auto rpc_header_size = std::size_t{12};
+
+inline auto make_rpc_frame(std::uint64_t id, std::uint32_t code, std::span<const char> body) -> std::string {
+  const auto id_buf = encode_u64(id);
+  const auto code_buf = encode_u32(code);
+  const auto size = encode_u32(static_cast<std::uint32_t>(rpc_header_size + body.size()));
+
+  auto frame = std::string{};
+  frame.reserve(frame_header_size + rpc_header_size + body.size());
+  frame.append(size.data(), size.size());
+  frame.append(id_buf.data(), id_buf.size());
+  frame.append(code_buf.data(), code_buf.size());
+  frame.append(body.data(), body.size());
+  return frame;
+}
+
+struct RpcReply {
+  std::uint32_t status = 0; // 0: ok, the rest is up to the service
+  std::string body;
+};
+
+struct RpcCallResult {
+  bool finished = false;
+  bool success = false; // false: the connection failed or closed before the reply
+  std::uint32_t status = 0;
+  std::string body;
+};
+
+struct RpcClientStats {
+  std::uint64_t calls = 0;
+  std::uint64_t replies = 0;
+  std::uint64_t failed = 0;
+  std::uint64_t unknown_replies = 0; // no call waiting for the id
+  std::size_t max_in_flight = 0;
+};
+
+// one request on a shared connection, resumes when the reply with its id arrives
+struct RpcCall {
+public:
+  RpcClient &client;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+  std::uint64_t id = 0;
+  std::uint32_t status = 0;
+  std::string body;
+
+public:
+  inline RpcCall(RpcClient *client, std::uint32_t method, std::span<const char> body);
+  inline RpcCall(const RpcCall &other) = delete;
+
+public:
+  inline auto io_replied(std::uint32_t status, std::span<const char> body) -> void {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = true;
+    this->status = status;
+    this->body.assign(body.data(), body.size());
+  }
+
+  inline auto io_failed() -> void {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = false;
+  }
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> RpcCallResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .status = status,
+      .body = std::move(body),
+    };
+  }
+};
+
+// resumes once the reader of a client has stopped
+struct RpcClientClosed {
+  RpcClient &client;
+
+  [[nodiscard]] inline auto await_ready() const -> bool;
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  inline auto await_resume() const noexcept -> void {}
+};
+
+// multiplexed client: many calls in flight on one connection, replies are routed by request id
+struct RpcClient {
+public:
+  TaskScheduler &ts;
+  TcpSocket &tcp_socket;
+  TcpStream stream;
+  FrameReader reader;
+  TcpWriteQueue queue;
+  RpcClientStats stats;
+
+  bool success = true;
+  bool closed = false; // the reader has stopped
+  bool *close_is_waiting = nullptr;
+
+  std::uint64_t next_id = 1;
+  std::unordered_map<std::uint64_t, RpcCall *> pending;
+
+public:
+  inline RpcClient(TcpSocket *sock, TcpWriteQueueOptions queue_options = {})
+      : ts{sock->ts}, tcp_socket{*sock}, stream{sock}, reader{&stream}, queue{sock, queue_options} {
+    ts.schedule_detached(run(ts, this));
+  }
+
+  inline RpcClient(const RpcClient &other) = delete;
+
+  inline ~RpcClient() {
+    assert(closed and "RpcClient must be closed (co_await client.close()) before it is destroyed");
+  }
+
+public:
+  // must be awaited, `body` may hold binary data
+  [[nodiscard]] inline auto call(std::uint32_t method, std::string_view body) -> RpcCall {
+    return {this, method, {body.data(), body.size()}};
+  }
+
+  // flushes queued requests, closes the socket and fails calls still waiting for a reply
+  inline auto close() -> Task<void> {
+    return close(ts, this);
+  }
+
+private:
+  static inline auto run(TaskScheduler &ts, RpcClient *client) -> Task<void>;
+  static inline auto close(TaskScheduler &ts, RpcClient *client) -> Task<void>;
+};
+
+inline RpcCall::RpcCall(RpcClient *client, std::uint32_t method, std::span<const char> body) : client{*client} {
+  if (not client->success) {
+    finished = true;
+    success = false;
+    return;
+  }
+
+  id = client->next_id;
+  client->next_id += 1;
+  if (not client->queue.push(make_rpc_frame(id, method, body))) {
+    finished = true;
+    success = false;
+    return;
+  }
+
+  client->pending.emplace(id, this);
+  client->stats.calls += 1;
+  if (client->stats.max_in_flight < client->pending.size()) {
+    client->stats.max_in_flight = client->pending.size();
+  }
+}
+
+inline auto RpcClientClosed::await_ready() const -> bool {
+  return client.closed;
+}
+
+template <typename TaskResult, typename Promise>
+inline auto RpcClientClosed::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  client.close_is_waiting = &cohandle.promise().is_waiting;
+  *client.close_is_waiting = true;
+}
+
+template <typename Promise>
+inline auto RpcClientClosed::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  client.close_is_waiting = &cohandle.promise().is_waiting;
+  *client.close_is_waiting = true;
+}
+
+inline auto RpcClient::run(TaskScheduler &, RpcClient *client) -> Task<void> {
+  while (true) {
+    auto frame_result = co_await client->reader.next();
+    if (not frame_result.success or frame_result.buf.size() < rpc_header_size) {
+      break;
+    }
+
+    const auto id = decode_u64(frame_result.buf);
+    const auto status = decode_u32(frame_result.buf.subspan(8));
+    auto it = client->pending.find(id);
+    if (it == client->pending.end()) {
+      client->stats.unknown_replies += 1;
+      continue;
+    }
+    auto call = it->second;
+    client->pending.erase(it);
+    client->stats.replies += 1;
+    call->io_replied(status, frame_result.buf.subspan(rpc_header_size));
+  }
+
+  // closed or failed
+  client->success = false;
+  for (auto &[id, call] : client->pending) {
+    client->stats.failed += 1;
+    call->io_failed();
+  }
+  client->pending.clear();
+
+  client->closed = true;
+  if (client->close_is_waiting != nullptr) {
+    *client->close_is_waiting = false;
+  }
+}
+
+inline auto RpcClient::close(TaskScheduler &, RpcClient *client) -> Task<void> {
+  co_await client->queue.close();
+  // the pending receive fails, the reader stops
+  client->tcp_socket.close();
+  co_await RpcClientClosed{*client};
+}
+
+// runs a request, may suspend (other requests of the connection keep running)
+using RpcHandler = std::function<Task<RpcReply>(TaskScheduler &ts, std::uint32_t method, std::string body)>;
+
+struct RpcServerStats {
+  std::uint64_t requests = 0;
+  std::size_t max_in_flight = 0;
+  std::uint64_t throttled = 0; // times reading stopped because `max_in_flight` requests were running
+};
+
+// resumes once at most `max_in_flight` requests of a connection are running (0: every request is answered)
+struct RpcServerDrain {
+  RpcServerConnection &conn;
+  std::size_t max_in_flight = 0;
+
+  [[nodiscard]] inline auto await_ready() const -> bool;
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  inline auto await_resume() const noexcept -> void {}
+};
+
+// server side of one connection: requests run concurrently, replies are sent as they finish
+struct RpcServerConnection {
+public:
+  TaskScheduler &ts;
+  TcpSocket &tcp_socket;
+  TcpStream stream;
+  FrameReader reader;
+  TcpWriteQueue queue;
+  RpcHandler handler;
+  RpcServerStats stats;
+
+  // the next frame is read only while fewer requests run, replies also wait for the queue high water mark
+  const std::size_t max_in_flight;
+  std::size_t in_flight = 0;
+  std::size_t drain_limit = 0;
+  bool *drain_is_waiting = nullptr;
+
+public:
+  inline RpcServerConnection(TcpSocket *sock, RpcHandler handler, TcpWriteQueueOptions queue_options = {},
+                             std::size_t max_in_flight = 64)
+      : ts{sock->ts}, tcp_socket{*sock}, stream{sock}, reader{&stream}, queue{sock, queue_options},
+        handler{std::move(handler)}, max_in_flight{max_in_flight == 0 ? 1 : max_in_flight} {}
+
+  inline RpcServerConnection(const RpcServerConnection &other) = delete;
+
+public:
+  // until the peer closes, then waits for running requests and closes the socket
+  inline auto serve() -> Task<void> {
+    return serve(ts, this);
+  }
+
+private:
+  static inline auto serve(TaskScheduler &ts, RpcServerConnection *conn) -> Task<void>;
+  static inline auto dispatch(TaskScheduler &ts, RpcServerConnection *conn, std::uint64_t id, std::uint32_t method,
+                              std::string body) -> Task<void>;
+};
+
+inline auto RpcServerDrain::await_ready() const -> bool {
+  return conn.in_flight <= max_in_flight;
+}
+
+template <typename TaskResult, typename Promise>
+inline auto RpcServerDrain::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  conn.drain_limit = max_in_flight;
+  conn.drain_is_waiting = &cohandle.promise().is_waiting;
+  *conn.drain_is_waiting = true;
+}
+
+template <typename Promise>
+inline auto RpcServerDrain::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  conn.drain_limit = max_in_flight;
+  conn.drain_is_waiting = &cohandle.promise().is_waiting;
+  *conn.drain_is_waiting = true;
+}
+
+inline auto RpcServerConnection::serve(TaskScheduler &ts, RpcServerConnection *conn) -> Task<void> {
+  while (true) {
+    // a peer pipelining requests without reading the replies is held back here
+    if (conn->in_flight >= conn->max_in_flight) {
+      conn->stats.throttled += 1;
+      co_await RpcServerDrain{*conn, conn->max_in_flight - 1};
+    }
+
+    auto frame_result = co_await conn->reader.next();
+    if (not frame_result.success or frame_result.buf.size() < rpc_header_size) {
+      break;
+    }
+
+    const auto id = decode_u64(frame_result.buf);
+    const auto method = decode_u32(frame_result.buf.subspan(8));
+    const auto body = frame_result.buf.subspan(rpc_header_size);
+
+    // the body is copied out, the stream buffer is reused by the next frame while the request runs
+    conn->in_flight += 1;
+    conn->stats.requests += 1;
+    if (conn->stats.max_in_flight < conn->in_flight) {
+      conn->stats.max_in_flight = conn->in_flight;
+    }
+    ts.schedule_detached(dispatch(ts, conn, id, method, std::string{body.data(), body.size()}));
+  }
+
+  co_await RpcServerDrain{*conn, 0};
+  co_await conn->queue.close();
+  conn->tcp_socket.close();
+}
+
+inline auto RpcServerConnection::dispatch(TaskScheduler &ts, RpcServerConnection *conn, std::uint64_t id,
+                                          std::uint32_t method, std::string body) -> Task<void> {
+  auto reply = co_await conn->handler(ts, method, std::move(body));
+  // counts as in flight until the reply fits below the high water mark
+  co_await conn->queue.write(make_rpc_frame(id, reply.status, reply.body));
+
+  conn->in_flight -= 1;
+  if (conn->in_flight <= conn->drain_limit and conn->drain_is_waiting != nullptr) {
+    *std::exchange(conn->drain_is_waiting, nullptr) = false;
+  }
+}
+
+} // namespace cotask
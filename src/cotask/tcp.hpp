@@ -2,15 +2,27 @@
 
 #include <cotask/cotask.hpp>
 #include <cotask/timer.hpp>
+#include <cotask/crc32c.hpp>
 
 #include <span>
+#include <deque>
+#include <concepts>
+#include <memory>
+#include <optional>
+#include <vector>
 #include <string>
 #include <string_view>
 
 namespace cotask {
 
+struct FileReader;
+
 struct TcpAcceptResult;
 struct TcpAccept;
+struct AcceptStream;
+struct AcceptBatchResult;
+struct AcceptBatch;
+struct AcceptStreamClose;
 
 struct TcpConnectResult;
 struct TcpConnect;
@@ -18,15 +30,63 @@ struct TcpConnect;
 struct TcpRecvResult;
 struct TcpRecv;
 struct TcpRecvAll;
+struct TcpRecvPooledResult;
+struct TcpRecvPooled;
+struct TcpRecvStream;
+struct TcpRecvStreamNext;
+struct TcpRecvStreamClose;
+struct TcpRecvVResult;
+struct TcpRecvV;
+struct TcpRecvAllV;
 
 struct TcpSendResult;
 struct TcpSend;
 struct TcpSendAll;
+struct TcpSendZeroCopy;
+struct TcpSendV;
+struct TcpSendAllV;
+
+struct TcpSendFileResult;
+struct TcpSendFile;
 
 } // namespace cotask
 
 namespace cotask {
 
+// socket tuning applied at listen, accept (inherited from the listener) and connect, unset fields keep the defaults
+struct SocketOptions {
+  std::optional<bool> no_delay;         // TCP_NODELAY (disable nagle)
+  std::optional<bool> quick_ack;        // SIO_TCP_SET_ACK_FREQUENCY 1 (no delayed acks)
+  std::optional<bool> fast_open;        // TCP_FASTOPEN
+  std::optional<bool> keep_alive;       // SO_KEEPALIVE
+  std::optional<int> send_buffer_size;  // SO_SNDBUF
+  std::optional<int> recv_buffer_size;  // SO_RCVBUF
+
+  // small request / response exchanges: no nagle, no delayed acks, fast open
+  [[nodiscard]] static inline auto low_latency() -> SocketOptions {
+    return {
+      .no_delay = true,
+      .quick_ack = true,
+      .fast_open = true,
+      .keep_alive = {},
+      .send_buffer_size = {},
+      .recv_buffer_size = {},
+    };
+  }
+
+  // large transfers: nagle on, large socket buffers
+  [[nodiscard]] static inline auto bulk_throughput() -> SocketOptions {
+    return {
+      .no_delay = false,
+      .quick_ack = false,
+      .fast_open = {},
+      .keep_alive = {},
+      .send_buffer_size = 4 * 1024 * 1024,
+      .recv_buffer_size = 4 * 1024 * 1024,
+    };
+  }
+};
+
 struct TcpSocket {
   friend TaskScheduler;
 
@@ -35,13 +95,18 @@ public:
 
 public:
   struct Impl;
-  alignas(8) std::uint8_t impl_storage[16]{};
+  alignas(8) std::uint8_t impl_storage[24]{};
   Impl *impl;
 
   TaskScheduler &ts;
+  SocketOptions options;
+
+  // optional, owned by this socket (copies do not share it), released once by `close`,
+  // frames of coroutines taking the socket are placed in it
+  ConnectionArena *arena = nullptr;
 
 public:
-  TcpSocket(TaskScheduler &ts);
+  TcpSocket(TaskScheduler &ts, SocketOptions options = {});
   TcpSocket(const TcpSocket &other);
   ~TcpSocket();
 
@@ -55,8 +120,24 @@ public:
 public:
   auto listen(std::uint16_t port) -> bool;
   auto close() -> bool;
+
+  // half close: the peer reads end of stream, receiving keeps working
+  auto shutdown_send() -> bool;
+
+  // stores the options and applies them right away when the socket is open
+  auto set_options(const SocketOptions &options) -> bool;
+
+  // false when an idle connection was closed or reset by the peer (or has unexpected data pending)
+  [[nodiscard]] auto is_alive() const -> bool;
 };
 
+// coroutines spawned for a connection (`f(ts, &sock, ...)`) allocate their frames from its arena,
+// a template so derived sockets (`UnixSocket *`) match it before the generic overload
+template <std::derived_from<TcpSocket> T>
+inline auto arena_of(T *sock) -> ConnectionArena * {
+  return sock->arena;
+}
+
 struct TcpAcceptResult {
   bool finished = false;
   bool success = false;
@@ -112,6 +193,154 @@ public:
   }
 };
 
+struct AcceptStreamOptions {
+  std::size_t depth = 16;     // accepts kept armed on the listening socket
+  std::size_t max_batch = 64; // connections handed out per batch
+};
+
+struct AcceptStreamStats {
+  std::uint64_t accepted = 0;
+  std::uint64_t batches = 0;
+  std::uint64_t failed = 0;
+  // times new connections had to wait in the listen backlog with no AcceptEx posted for them:
+  // every slot completed before the loop re-armed any (depth > 1), or a re-arm failed
+  // (with depth 1 the only slot is always briefly unarmed, that alone is not counted)
+  std::uint64_t backlog_full = 0;
+};
+
+struct AcceptBatchResult {
+  bool finished = false;
+  bool success = false;
+  std::vector<std::shared_ptr<TcpSocket>> sockets;
+};
+
+// resumes with the connections accepted since the last batch
+struct AcceptBatch {
+public:
+  AcceptStream &stream;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool;
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  inline auto await_resume() -> AcceptBatchResult;
+};
+
+// resumes once every armed accept is cancelled
+struct AcceptStreamClose {
+public:
+  AcceptStream &stream;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool;
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  inline auto await_resume() const noexcept -> void {}
+};
+
+// keeps several accepts armed on a listening socket and hands out new connections in batches
+struct AcceptStream {
+  friend TaskScheduler;
+
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[32]{};
+  Impl *impl;
+
+  TcpSocket &tcp_socket;
+  TaskScheduler &ts;
+  AcceptStreamOptions options;
+  AcceptStreamStats stats;
+
+  bool success = false;
+  bool closing = false;
+  std::size_t armed = 0;
+  bool *is_waiting = nullptr;
+  bool *close_is_waiting = nullptr;
+
+  std::vector<std::shared_ptr<TcpSocket>> ready;
+
+public:
+  AcceptStream(TcpSocket *sock, AcceptStreamOptions options = {});
+  inline AcceptStream(const AcceptStream &other) = delete;
+  ~AcceptStream();
+
+public:
+  inline auto next() -> AcceptBatch {
+    return {*this};
+  }
+
+  // stop accepting, must be awaited before the stream is destroyed
+  auto close() -> AcceptStreamClose;
+
+public:
+  auto io_accepted(std::size_t slot) -> void;
+  auto io_failed(std::size_t slot, std::uint32_t err_code) -> void;
+
+private:
+  auto arm(std::size_t slot) -> bool;
+  auto wake() -> void;
+};
+
+inline auto AcceptBatch::await_ready() const -> bool {
+  return not stream.ready.empty() or stream.closing or not stream.success;
+}
+
+template <typename TaskResult, typename Promise>
+inline auto AcceptBatch::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  stream.is_waiting = &cohandle.promise().is_waiting;
+  *stream.is_waiting = true;
+}
+
+template <typename Promise>
+inline auto AcceptBatch::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  stream.is_waiting = &cohandle.promise().is_waiting;
+  *stream.is_waiting = true;
+}
+
+inline auto AcceptBatch::await_resume() -> AcceptBatchResult {
+  stream.is_waiting = nullptr;
+
+  auto result = AcceptBatchResult{};
+  const auto count = stream.ready.size() < stream.options.max_batch ? stream.ready.size() : stream.options.max_batch;
+  result.sockets.assign(std::make_move_iterator(stream.ready.begin()),
+                        std::make_move_iterator(stream.ready.begin() + static_cast<std::ptrdiff_t>(count)));
+  stream.ready.erase(stream.ready.begin(), stream.ready.begin() + static_cast<std::ptrdiff_t>(count));
+
+  result.finished = true;
+  result.success = not result.sockets.empty();
+  if (result.success) {
+    stream.stats.batches += 1;
+  }
+  return result;
+}
+
+inline auto AcceptStreamClose::await_ready() const -> bool {
+  return stream.armed == 0;
+}
+
+template <typename TaskResult, typename Promise>
+inline auto AcceptStreamClose::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  stream.close_is_waiting = &cohandle.promise().is_waiting;
+  *stream.close_is_waiting = true;
+}
+
+template <typename Promise>
+inline auto AcceptStreamClose::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  stream.close_is_waiting = &cohandle.promise().is_waiting;
+  *stream.close_is_waiting = true;
+}
+
 struct TcpConnectResult {
   bool finished = false;
   bool success = false;
@@ -122,7 +351,7 @@ struct TcpConnect {
 
 private:
   struct Impl;
-  alignas(8) std::uint8_t impl_storage[48]{};
+  alignas(8) std::uint8_t impl_storage[56]{};
   Impl *impl;
 
 public:
@@ -134,11 +363,13 @@ public:
   bool success = false;
 
 public:
+  // the host is resolved on the worker pool (or taken from `ts.dns`), the event loop never blocks on it
   TcpConnect(TcpSocket *sock, std::string_view ip, std::string_view port);
   inline TcpConnect(const TcpConnect &other) = delete;
   ~TcpConnect();
 
 public:
+  auto io_connect(const void *addr) -> bool;
   auto io_received(std::uint32_t bytes_received) -> void;
   auto io_failed(std::uint32_t err_code) -> void;
 
@@ -171,6 +402,7 @@ struct TcpRecvResult {
   bool finished = false;
   bool success = false;
   std::span<char> buf;
+  std::uint32_t crc32c = 0; // set when received with `Checksum::Crc32c`
 
   [[nodiscard]] inline auto get_string() const -> std::string {
     return {buf.data(), buf.size()};
@@ -201,8 +433,11 @@ public:
   std::uint32_t bytes_received = 0;
   Timer timer;
 
+  Checksum checksum;
+  Crc32c crc;
+
 public:
-  TcpRecv(TcpSocket *sock, std::span<char> buf, std::uint64_t timeout = 0);
+  TcpRecv(TcpSocket *sock, std::span<char> buf, std::uint64_t timeout = 0, Checksum checksum = Checksum::None);
   inline TcpRecv(const TcpRecv &other) = delete;
   ~TcpRecv();
 
@@ -234,6 +469,7 @@ public:
       .finished = finished,
       .success = success,
       .buf = {buf.data(), bytes_received},
+      .crc32c = crc.value(),
     };
   }
 };
@@ -259,8 +495,11 @@ public:
   std::size_t total_bytes_received = 0;
   Timer timer;
 
+  Checksum checksum;
+  Crc32c crc;
+
 public:
-  TcpRecvAll(TcpSocket *sock, std::span<char> buf, std::uint64_t timeout = 0);
+  TcpRecvAll(TcpSocket *sock, std::span<char> buf, std::uint64_t timeout = 0, Checksum checksum = Checksum::None);
   inline TcpRecvAll(const TcpRecvAll &other) = delete;
   ~TcpRecvAll();
 
@@ -293,14 +532,312 @@ public:
       .finished = finished,
       .success = success,
       .buf = buf,
+      .crc32c = crc.value(),
     };
   }
 };
 
+struct TcpRecvVResult {
+  bool finished = false;
+  bool success = false;
+  std::size_t bytes_received = 0; // filled in buffer order
+};
+
+// scatter receive into several buffers with one request
+struct TcpRecvV {
+  friend TaskScheduler;
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[224]{};
+  Impl *impl;
+
+public:
+  TcpSocket &tcp_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+  bool all;
+
+  std::span<const std::span<char>> bufs;
+  std::size_t total_size = 0;
+  std::size_t total_bytes_received = 0;
+  Timer timer;
+
+public:
+  TcpRecvV(TcpSocket *sock, std::span<const std::span<char>> bufs, std::uint64_t timeout = 0, bool all = false);
+  inline TcpRecvV(const TcpRecvV &other) = delete;
+  ~TcpRecvV();
+
+public:
+  auto io_request() -> bool;
+  auto io_received(std::uint32_t bytes_received) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return timer.ended or finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    this->timer.is_waiting = this->is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    this->timer.is_waiting = this->is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> TcpRecvVResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .bytes_received = total_bytes_received,
+    };
+  }
+};
+
+// fills every buffer, continuing across buffer boundaries after partial receives
+struct TcpRecvAllV : public TcpRecvV {
+  inline TcpRecvAllV(TcpSocket *sock, std::span<const std::span<char>> bufs, std::uint64_t timeout = 0)
+      : TcpRecvV{sock, bufs, timeout, true} {}
+};
+
+struct TcpRecvPooledResult {
+  bool finished = false;
+  bool success = false;
+  AlignedBuffer lease; // returned to the scheduler pool when destroyed
+  std::span<char> buf;
+
+  [[nodiscard]] inline auto get_string() const -> std::string {
+    return {buf.data(), buf.size()};
+  }
+
+  [[nodiscard]] inline auto get_string_view() const -> std::string_view {
+    return {buf.data(), buf.size()};
+  }
+};
+
+// waits for data without a buffer, then receives into a buffer leased from the scheduler pool
+struct TcpRecvPooled {
+  friend TaskScheduler;
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[48]{};
+  Impl *impl;
+
+public:
+  TcpSocket &tcp_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+  std::size_t max_size;
+  AlignedBuffer lease;
+  std::span<char> buf;
+  Timer timer;
+
+public:
+  TcpRecvPooled(TcpSocket *sock, std::size_t max_size = 16 * 1024, std::uint64_t timeout = 0);
+  inline TcpRecvPooled(const TcpRecvPooled &other) = delete;
+  ~TcpRecvPooled();
+
+public:
+  auto io_request() -> bool;
+  auto io_received(std::uint32_t bytes_received) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return timer.ended or finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    this->timer.is_waiting = this->is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    this->timer.is_waiting = this->is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> TcpRecvPooledResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .lease = std::move(lease),
+      .buf = buf,
+    };
+  }
+};
+
+struct TcpRecvStreamOptions {
+  std::size_t chunk_size = 64 * 1024; // size of each pooled receive buffer
+  std::size_t max_queued = 16;        // stop receiving while this many chunks wait for the consumer
+  // reads up to this size are copied behind the last queued chunk when it has room,
+  // so small reads do not pin a whole buffer each
+  std::size_t coalesce_below = 4 * 1024;
+};
+
+struct TcpRecvStreamStats {
+  std::uint64_t chunks = 0;
+  std::uint64_t bytes = 0;
+  std::uint64_t requests = 0;  // receive operations submitted
+  std::uint64_t paused = 0;    // times receiving stopped because the consumer fell behind
+  std::uint64_t coalesced = 0; // reads copied into the last queued chunk
+};
+
+// resumes with the next received chunk
+struct TcpRecvStreamNext {
+public:
+  TcpRecvStream &stream;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool;
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  inline auto await_resume() -> TcpRecvPooledResult;
+};
+
+// resumes once the armed receive is cancelled
+struct TcpRecvStreamClose {
+public:
+  TcpRecvStream &stream;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool;
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void;
+
+  inline auto await_resume() const noexcept -> void {}
+};
+
+// persistent receive subscription: stays armed and queues chunks until the consumer takes them
+struct TcpRecvStream {
+  friend TaskScheduler;
+
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[48]{};
+  Impl *impl;
+
+  TcpSocket &tcp_socket;
+  TaskScheduler &ts;
+  TcpRecvStreamOptions options;
+  TcpRecvStreamStats stats;
+
+  bool success = false;
+  bool eof = false;
+  bool closing = false;
+  bool armed = false;
+  bool *is_waiting = nullptr;
+  bool *close_is_waiting = nullptr;
+
+  AlignedBuffer lease; // buffer of the armed receive
+  std::deque<TcpRecvPooledResult> ready;
+
+public:
+  TcpRecvStream(TcpSocket *sock, TcpRecvStreamOptions options = {});
+  inline TcpRecvStream(const TcpRecvStream &other) = delete;
+  ~TcpRecvStream();
+
+public:
+  inline auto next() -> TcpRecvStreamNext {
+    return {*this};
+  }
+
+  // stop receiving, must be awaited before the stream is destroyed
+  auto close() -> TcpRecvStreamClose;
+
+public:
+  auto io_received(std::uint32_t bytes_received) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+  // re-arms after the consumer drained the queue
+  auto resume() -> void;
+
+private:
+  auto arm() -> bool;
+  auto wake() -> void;
+};
+
+inline auto TcpRecvStreamNext::await_ready() const -> bool {
+  return not stream.ready.empty() or stream.eof or stream.closing or not stream.success;
+}
+
+template <typename TaskResult, typename Promise>
+inline auto TcpRecvStreamNext::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  stream.is_waiting = &cohandle.promise().is_waiting;
+  *stream.is_waiting = true;
+}
+
+template <typename Promise>
+inline auto TcpRecvStreamNext::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  stream.is_waiting = &cohandle.promise().is_waiting;
+  *stream.is_waiting = true;
+}
+
+inline auto TcpRecvStreamNext::await_resume() -> TcpRecvPooledResult {
+  stream.is_waiting = nullptr;
+  if (stream.ready.empty()) {
+    return {
+      .finished = true,
+      .success = false,
+      .lease = {},
+      .buf = {},
+    };
+  }
+
+  auto chunk = std::move(stream.ready.front());
+  stream.ready.pop_front();
+  stream.resume();
+  return chunk;
+}
+
+inline auto TcpRecvStreamClose::await_ready() const -> bool {
+  return not stream.armed;
+}
+
+template <typename TaskResult, typename Promise>
+inline auto TcpRecvStreamClose::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  stream.close_is_waiting = &cohandle.promise().is_waiting;
+  *stream.close_is_waiting = true;
+}
+
+template <typename Promise>
+inline auto TcpRecvStreamClose::await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+  stream.close_is_waiting = &cohandle.promise().is_waiting;
+  *stream.close_is_waiting = true;
+}
+
 struct TcpSendResult {
   bool finished = false;
   bool success = false;
-  std::uint32_t bytes_sent = 0;
+  std::uint64_t bytes_sent = 0; // vectored and zero copy sends can go past 4 GiB
 };
 
 struct TcpSend {
@@ -412,4 +949,196 @@ public:
   }
 };
 
+// sends from the caller's buffer without copying it into the socket send buffer,
+// resumes once the buffer can be reused (sends below `threshold` are ordinary copying sends)
+struct TcpSendZeroCopy {
+  friend TaskScheduler;
+
+  static constexpr auto default_threshold = std::size_t{256 * 1024};
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[48]{};
+  Impl *impl;
+
+public:
+  TcpSocket &tcp_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+  bool zero_copy = false;
+
+  std::span<const char> buf;
+  std::size_t total_bytes_sent = 0;
+
+public:
+  TcpSendZeroCopy(TcpSocket *sock, std::span<const char> buf, std::size_t threshold = default_threshold);
+  inline TcpSendZeroCopy(const TcpSendZeroCopy &other) = delete;
+  ~TcpSendZeroCopy();
+
+public:
+  auto io_request() -> bool;
+  auto io_sent(std::uint32_t bytes_sent) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> TcpSendResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .bytes_sent = total_bytes_sent,
+    };
+  }
+};
+
+// gather send from several buffers with one request
+struct TcpSendV {
+  friend TaskScheduler;
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[224]{};
+  Impl *impl;
+
+public:
+  TcpSocket &tcp_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+  bool all;
+
+  std::span<const std::span<const char>> bufs;
+  std::size_t total_size = 0;
+  std::size_t total_bytes_sent = 0;
+
+public:
+  TcpSendV(TcpSocket *sock, std::span<const std::span<const char>> bufs, bool all = false);
+  inline TcpSendV(const TcpSendV &other) = delete;
+  ~TcpSendV();
+
+public:
+  auto io_request() -> bool;
+  auto io_sent(std::uint32_t bytes_sent) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> TcpSendResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .bytes_sent = total_bytes_sent,
+    };
+  }
+};
+
+// sends every buffer, continuing across buffer boundaries after partial sends
+struct TcpSendAllV : public TcpSendV {
+  inline TcpSendAllV(TcpSocket *sock, std::span<const std::span<const char>> bufs) : TcpSendV{sock, bufs, true} {}
+};
+
+struct TcpSendFileResult {
+  bool finished = false;
+  bool success = false;
+  std::uint64_t bytes_sent = 0;
+};
+
+// sends a file range without copying it through userspace
+struct TcpSendFile {
+  friend TaskScheduler;
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[48]{};
+  Impl *impl;
+
+public:
+  TcpSocket &tcp_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+  FileReader *reader;
+  std::uint64_t offset = 0;
+  std::uint64_t length = 0;
+  std::uint64_t total_bytes_sent = 0;
+  Timer timer;
+
+public:
+  // length 0 sends to the end of the file
+  TcpSendFile(TcpSocket *sock, FileReader *reader, std::uint64_t offset = 0, std::uint64_t length = 0,
+              std::uint64_t timeout = 0);
+  inline TcpSendFile(const TcpSendFile &other) = delete;
+  ~TcpSendFile();
+
+public:
+  auto io_request() -> bool;
+  auto io_sent(std::uint32_t bytes_sent) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return timer.ended or finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    this->timer.is_waiting = this->is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    this->timer.is_waiting = this->is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> TcpSendFileResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .bytes_sent = total_bytes_sent,
+    };
+  }
+};
+
 } // namespace cotask
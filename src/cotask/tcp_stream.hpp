@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+
+#include <span>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <string_view>
+
+namespace cotask {
+
+struct TcpStreamResult {
+  bool finished = false; // false: timeout
+  bool success = false;  // false: closed before enough bytes arrived, failed or too large
+  std::span<char> buf;   // view into the stream buffer, valid until the next read
+
+  [[nodiscard]] inline auto get_string() const -> std::string {
+    return {buf.data(), buf.size()};
+  }
+
+  [[nodiscard]] inline auto get_string_view() const -> std::string_view {
+    return {buf.data(), buf.size()};
+  }
+};
+
+struct TcpStreamStats {
+  std::uint64_t recvs = 0;
+  std::uint64_t bytes = 0;
+  std::uint64_t grows = 0;
+};
+
+// buffered reader over a socket, each recv asks for as much as fits in the free buffer space
+struct TcpStream {
+public:
+  TaskScheduler &ts;
+  TcpSocket &tcp_socket;
+  std::uint64_t timeout;
+  std::size_t max_size; // the buffer never grows past this
+  TcpStreamStats stats;
+
+  bool eof = false;
+
+  // unread bytes are [head, tail)
+  std::vector<char> buffer;
+  std::size_t head = 0;
+  std::size_t tail = 0;
+
+public:
+  inline TcpStream(TcpSocket *sock, std::size_t initial_size = 16 * 1024, std::size_t max_size = 16 * 1024 * 1024,
+                   std::uint64_t timeout = 0)
+      : ts{sock->ts}, tcp_socket{*sock}, timeout{timeout}, max_size{max_size},
+        buffer(initial_size < 64 ? 64 : initial_size) {}
+
+  inline TcpStream(const TcpStream &other) = delete;
+
+public:
+  [[nodiscard]] inline auto buffered() -> std::span<char> {
+    return {buffer.data() + head, tail - head};
+  }
+
+  inline auto consume(std::size_t n) -> void {
+    head += n < tail - head ? n : tail - head;
+    if (head == tail) {
+      head = 0;
+      tail = 0;
+    }
+  }
+
+  // consumes exactly `n` bytes
+  inline auto read_exact(std::size_t n) -> Task<TcpStreamResult> {
+    return read_exact(ts, this, n);
+  }
+
+  // consumes up to and including `delimiter`
+  inline auto read_until(std::string delimiter) -> Task<TcpStreamResult> {
+    return read_until(ts, this, std::move(delimiter));
+  }
+
+  // waits until at least `n` bytes are buffered without consuming them
+  inline auto peek(std::size_t n = 1) -> Task<TcpStreamResult> {
+    return peek(ts, this, n);
+  }
+
+  // consumes whatever is buffered, receives once if nothing is
+  inline auto read_some() -> Task<TcpStreamResult> {
+    return read_some(ts, this);
+  }
+
+public:
+  // receives once into the free space, making room for at least `want` unread bytes
+  static inline auto fill(TaskScheduler &ts, TcpStream *stream, std::size_t want) -> Task<TcpStreamResult>;
+
+private:
+  static inline auto read_exact(TaskScheduler &ts, TcpStream *stream, std::size_t n) -> Task<TcpStreamResult>;
+  static inline auto read_until(TaskScheduler &ts, TcpStream *stream, std::string delimiter)
+    -> Task<TcpStreamResult>;
+  static inline auto peek(TaskScheduler &ts, TcpStream *stream, std::size_t n) -> Task<TcpStreamResult>;
+  static inline auto read_some(TaskScheduler &ts, TcpStream *stream) -> Task<TcpStreamResult>;
+
+  inline auto reserve(std::size_t want) -> bool {
+    const auto unread = tail - head;
+    // room for `want` unread bytes and at least one more byte to receive
+    const auto needed = want > unread ? want : unread + 1;
+    if (needed > max_size) {
+      return false;
+    }
+
+    // compact, unread bytes move to the front
+    if (head != 0 and (buffer.size() - head < needed or buffer.size() - tail < buffer.size() / 4)) {
+      std::memmove(buffer.data(), buffer.data() + head, unread);
+      head = 0;
+      tail = unread;
+    }
+
+    // grow
+    if (buffer.size() < needed) {
+      auto new_size = buffer.size() * 2;
+      while (new_size < needed) {
+        new_size *= 2;
+      }
+      buffer.resize(new_size < max_size ? new_size : max_size);
+      stats.grows += 1;
+    }
+    return true;
+  }
+};
+
+inline auto TcpStream::fill(TaskScheduler &, TcpStream *stream, std::size_t want) -> Task<TcpStreamResult> {
+  if (stream->eof or not stream->reserve(want)) {
+    co_return TcpStreamResult{.finished = true, .success = false, .buf = {}};
+  }
+
+  auto free_space = std::span<char>{stream->buffer.data() + stream->tail, stream->buffer.size() - stream->tail};
+  auto recv_result = co_await TcpRecv{&stream->tcp_socket, free_space, stream->timeout};
+  if (not recv_result.finished) {
+    // timeout
+    co_return TcpStreamResult{.finished = false, .success = false, .buf = {}};
+  }
+  if (not recv_result.success) {
+    // closed
+    stream->eof = true;
+    co_return TcpStreamResult{.finished = true, .success = false, .buf = {}};
+  }
+
+  stream->tail += recv_result.buf.size();
+  stream->stats.recvs += 1;
+  stream->stats.bytes += recv_result.buf.size();
+  co_return TcpStreamResult{.finished = true, .success = true, .buf = recv_result.buf};
+}
+
+inline auto TcpStream::read_exact(TaskScheduler &ts, TcpStream *stream, std::size_t n) -> Task<TcpStreamResult> {
+  while (stream->tail - stream->head < n) {
+    auto fill_result = co_await fill(ts, stream, n);
+    if (not fill_result.success) {
+      co_return fill_result;
+    }
+  }
+
+  auto buf = std::span<char>{stream->buffer.data() + stream->head, n};
+  stream->head += n;
+  co_return TcpStreamResult{.finished = true, .success = true, .buf = buf};
+}
+
+inline auto TcpStream::read_until(TaskScheduler &ts, TcpStream *stream, std::string delimiter)
+  -> Task<TcpStreamResult> {
+  // only bytes that arrived since the last search need to be searched again
+  auto searched = std::size_t{0};
+  while (true) {
+    const auto unread = std::string_view{stream->buffer.data() + stream->head, stream->tail - stream->head};
+    const auto pos = unread.find(delimiter, searched);
+    if (pos != std::string_view::npos) {
+      const auto n = pos + delimiter.size();
+      auto buf = std::span<char>{stream->buffer.data() + stream->head, n};
+      stream->head += n;
+      co_return TcpStreamResult{.finished = true, .success = true, .buf = buf};
+    }
+    searched = unread.size() < delimiter.size() ? 0 : unread.size() - delimiter.size() + 1;
+
+    auto fill_result = co_await fill(ts, stream, unread.size() + 1);
+    if (not fill_result.success) {
+      co_return fill_result;
+    }
+  }
+}
+
+inline auto TcpStream::peek(TaskScheduler &ts, TcpStream *stream, std::size_t n) -> Task<TcpStreamResult> {
+  while (stream->tail - stream->head < n) {
+    auto fill_result = co_await fill(ts, stream, n);
+    if (not fill_result.success) {
+      co_return fill_result;
+    }
+  }
+
+  co_return TcpStreamResult{.finished = true, .success = true, .buf = stream->buffered()};
+}
+
+inline auto TcpStream::read_some(TaskScheduler &ts, TcpStream *stream) -> Task<TcpStreamResult> {
+  if (stream->tail == stream->head) {
+    auto fill_result = co_await fill(ts, stream, 1);
+    if (not fill_result.success) {
+      co_return fill_result;
+    }
+  }
+
+  auto buf = stream->buffered();
+  stream->head = stream->tail;
+  co_return TcpStreamResult{.finished = true, .success = true, .buf = buf};
+}
+
+} // namespace cotask
@@ -2,6 +2,8 @@
 
 #include <cotask/cotask.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 
 namespace cotask {
@@ -40,4 +42,47 @@ public:
   }
 };
 
+// suspends for `duration` (os timer resolution), `cancel` resumes it early
+struct TimerSleep {
+public:
+  TaskScheduler &ts;
+  Timer timer;
+  std::atomic<bool> fired = false; // the timer callback posted the completion
+  bool started = false;
+
+public:
+  TimerSleep(TaskScheduler &ts, std::chrono::microseconds duration);
+  inline TimerSleep(const TimerSleep &other) = delete;
+
+public:
+  // the sleeping coroutine resumes on the next pass, safe to call when already ended
+  auto cancel() -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const noexcept -> bool {
+    return timer.ended;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    timer.is_waiting = &cohandle.promise().is_waiting;
+    *timer.is_waiting = true;
+    start();
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    timer.is_waiting = &cohandle.promise().is_waiting;
+    *timer.is_waiting = true;
+    start();
+  }
+
+  inline auto await_resume() noexcept -> void {
+    timer.is_waiting = nullptr;
+  }
+
+private:
+  auto start() -> void;
+};
+
 } // namespace cotask
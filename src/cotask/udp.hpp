@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace cotask {
+
+struct UdpSocket;
+struct UdpBatchResult;
+struct UdpRecvBatch;
+struct UdpSendBatch;
+
+} // namespace cotask
+
+namespace cotask {
+
+struct UdpAddress {
+  std::uint32_t ip = 0;   // ipv4, network byte order
+  std::uint16_t port = 0; // host byte order
+
+  [[nodiscard]] static auto from_string(std::string_view ip, std::uint16_t port) -> UdpAddress;
+  [[nodiscard]] auto to_string() const -> std::string;
+
+  inline auto operator==(const UdpAddress &other) const -> bool = default;
+};
+
+struct UdpDatagram {
+  // receive: caller provided, or leased from the scheduler pool (`UdpSocket::max_datagram_size`) when empty
+  std::span<char> buf;
+  std::size_t size = 0;           // bytes received / to send
+  UdpAddress address;             // source (receive) / destination (send)
+  std::uint32_t segment_size = 0; // > 0: `buf` holds coalesced datagrams of this size (GRO receive / GSO send)
+  AlignedBuffer lease;
+
+  [[nodiscard]] inline auto data() const -> std::span<char> {
+    return buf.first(size);
+  }
+};
+
+struct UdpSocket {
+  friend TaskScheduler;
+
+public:
+  const AsyncIoType type = AsyncIoType::UdpSocket;
+
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[16]{};
+  Impl *impl;
+
+  TaskScheduler &ts;
+  std::size_t max_datagram_size = 2048; // size of pooled receive buffers (raised by `enable_gro`)
+
+public:
+  UdpSocket(TaskScheduler &ts);
+  inline UdpSocket(const UdpSocket &other) = delete;
+  ~UdpSocket();
+
+public:
+  // port 0: any free port
+  auto bind(std::uint16_t port = 0) -> bool;
+  auto close() -> bool;
+
+  // lets the stack coalesce received datagrams of one flow into a single buffer (receive offload)
+  auto enable_gro(std::uint32_t max_coalesced_size = 65535) -> bool;
+};
+
+struct UdpBatchResult {
+  bool finished = false;
+  bool success = false;
+  std::size_t count = 0; // datagrams received / sent, from the front of the batch
+};
+
+// waits for one datagram, then takes whatever else is queued without waiting, up to the batch size
+struct UdpRecvBatch {
+  friend TaskScheduler;
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[176]{};
+  Impl *impl;
+
+public:
+  UdpSocket &udp_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+  std::span<UdpDatagram> datagrams;
+  std::size_t count = 0;
+
+public:
+  UdpRecvBatch(UdpSocket *sock, std::span<UdpDatagram> datagrams);
+  inline UdpRecvBatch(const UdpRecvBatch &other) = delete;
+  ~UdpRecvBatch();
+
+public:
+  auto io_received(std::uint32_t bytes_received) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+private:
+  auto prepare(std::size_t index) -> void;
+  auto complete(std::size_t index, std::uint32_t bytes_received) -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> UdpBatchResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .count = count,
+    };
+  }
+};
+
+// sends without waiting while the socket accepts datagrams, only waits on a full send buffer
+struct UdpSendBatch {
+  friend TaskScheduler;
+
+private:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[160]{};
+  Impl *impl;
+
+public:
+  UdpSocket &udp_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+  std::span<const UdpDatagram> datagrams;
+  std::size_t count = 0;
+
+public:
+  UdpSendBatch(UdpSocket *sock, std::span<const UdpDatagram> datagrams);
+  inline UdpSendBatch(const UdpSendBatch &other) = delete;
+  ~UdpSendBatch();
+
+public:
+  auto io_sent(std::uint32_t bytes_sent) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+private:
+  auto prepare(std::size_t index) -> void;
+  auto send_all() -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> UdpBatchResult {
+    return {
+      .finished = finished,
+      .success = success,
+      .count = count,
+    };
+  }
+};
+
+} // namespace cotask
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+
+#include <string>
+#include <string_view>
+
+namespace cotask {
+
+struct UnixSocket;
+struct UnixAccept;
+struct UnixConnect;
+
+} // namespace cotask
+
+namespace cotask {
+
+struct UnixRecvHandleResult {
+  bool success = false;
+  void *handle = nullptr; // native handle, owned by the receiver
+};
+
+// local stream socket bound to a file system path
+// a `TcpSocket`: recv / send / stream / write queue awaitables work on it unchanged
+struct UnixSocket : public TcpSocket {
+public:
+  std::string path; // bound path of a listener, removed again by `close`
+
+public:
+  UnixSocket(TaskScheduler &ts);
+
+public:
+  // an existing file at `path` is replaced (stale socket of a previous run)
+  auto listen(std::string_view path) -> bool;
+  auto close() -> bool;
+
+  [[nodiscard]] auto peer_process_id() const -> std::uint32_t;
+
+public:
+  // passes a socket to the peer process, `passed` stays open here
+  inline auto send_socket(TcpSocket *passed) -> Task<bool> {
+    return send_socket(ts, this, passed);
+  }
+
+  // `received` is opened and bound to this scheduler
+  inline auto recv_socket(TcpSocket *received) -> Task<bool> {
+    return recv_socket(ts, this, received);
+  }
+
+  // passes a native handle (open file, pipe, ...) to the peer process, `handle` stays open here
+  inline auto send_handle(void *handle) -> Task<bool> {
+    return send_handle(ts, this, handle);
+  }
+
+  inline auto recv_handle() -> Task<UnixRecvHandleResult> {
+    return recv_handle(ts, this);
+  }
+
+private:
+  static auto send_socket(TaskScheduler &ts, UnixSocket *sock, TcpSocket *passed) -> Task<bool>;
+  static auto recv_socket(TaskScheduler &ts, UnixSocket *sock, TcpSocket *received) -> Task<bool>;
+  static auto send_handle(TaskScheduler &ts, UnixSocket *sock, void *handle) -> Task<bool>;
+  static auto recv_handle(TaskScheduler &ts, UnixSocket *sock) -> Task<UnixRecvHandleResult>;
+};
+
+struct UnixAcceptResult {
+  bool finished = false;
+  bool success = false;
+};
+
+// overlapped accept (AcceptEx), the same as `TcpAccept`
+struct UnixAccept {
+  friend TaskScheduler;
+
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[320]{};
+  Impl *impl;
+
+public:
+  UnixSocket &unix_socket;
+  UnixSocket &accept_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+public:
+  UnixAccept(UnixSocket *sock, UnixSocket *accept_socket);
+  inline UnixAccept(const UnixAccept &other) = delete;
+  ~UnixAccept();
+
+public:
+  auto io_accepted(std::uint32_t bytes_transferred) -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> UnixAcceptResult {
+    return {
+      .finished = finished,
+      .success = success,
+    };
+  }
+};
+
+struct UnixConnectResult {
+  bool finished = false;
+  bool success = false;
+};
+
+// connect on the worker pool
+struct UnixConnect {
+  friend TaskScheduler;
+
+public:
+  struct Impl;
+  alignas(8) std::uint8_t impl_storage[200]{};
+  Impl *impl;
+
+public:
+  UnixSocket &unix_socket;
+  TaskScheduler &ts;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+public:
+  UnixConnect(UnixSocket *sock, std::string_view path);
+  inline UnixConnect(const UnixConnect &other) = delete;
+  ~UnixConnect();
+
+public:
+  auto io_connected() -> void;
+  auto io_failed(std::uint32_t err_code) -> void;
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished or not success;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> UnixConnectResult {
+    return {
+      .finished = finished,
+      .success = success,
+    };
+  }
+};
+
+} // namespace cotask
@@ -1,6 +1,10 @@
 #include "cotask.hpp"
+#include "dns.hpp"
 #include "file.hpp"
+#include "fs.hpp"
 #include "tcp.hpp"
+#include "udp.hpp"
+#include "unix_socket.hpp"
 
 #include <cotask/impl.hpp>
 #include <cotask/utils.hpp>
@@ -100,12 +104,13 @@ auto TaskScheduler::execute() -> void {
       } break;
 
       case AsyncIoType::FileRead: {
-        auto reader = std::bit_cast<FileReader *>(completion_key);
+        // completion key is the reader or a cached handle entry, use the reader of the awaitable
         auto ov = reinterpret_cast<OverlappedFile *>(overlapped);
 
         switch (ov->type) {
         case FileIoType::ReadBuf: {
           auto ovex = reinterpret_cast<OverlappedFileReadBuf *>(ov);
+          auto reader = ovex->awaitable->reader;
           if (not ::GetOverlappedResult(reader->impl->file_handle, overlapped, &n, TRUE)) {
             const auto err_code = ::GetLastError();
             if (err_code != ERROR_HANDLE_EOF) {
@@ -118,6 +123,7 @@ auto TaskScheduler::execute() -> void {
 
         case FileIoType::ReadAll: {
           auto ovex = reinterpret_cast<OverlappedFileReadAll *>(ov);
+          auto reader = ovex->awaitable->reader;
           if (not ::GetOverlappedResult(reader->impl->file_handle, overlapped, &n, TRUE)) {
             const auto err_code = ::GetLastError();
             if (err_code != ERROR_HANDLE_EOF) {
@@ -127,11 +133,56 @@ auto TaskScheduler::execute() -> void {
           }
           ovex->awaitable->io_read(bytes_transferred);
         } break;
+
+        default:
+          break;
         }
       } break;
 
       case AsyncIoType::FileWrite: {
-        // TODO
+        auto ov = reinterpret_cast<OverlappedFile *>(overlapped);
+
+        switch (ov->type) {
+        case FileIoType::WriteBuf: {
+          auto ovex = reinterpret_cast<OverlappedFileWriteBuf *>(ov);
+          auto writer = ovex->awaitable->writer;
+          if (not ::GetOverlappedResult(writer->impl->file_handle, overlapped, &n, TRUE)) {
+            const auto err_code = ::GetLastError();
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_written(bytes_transferred);
+        } break;
+
+        case FileIoType::Flush: {
+          auto ovex = reinterpret_cast<OverlappedFileFlush *>(ov);
+          ovex->awaitable->io_flushed(ovex->err_code);
+        } break;
+
+        default:
+          break;
+        }
+      } break;
+
+      case AsyncIoType::FileSystem: {
+        auto ov = reinterpret_cast<OverlappedFs *>(overlapped);
+
+        switch (ov->type) {
+        case FsIoType::ListDir: {
+          auto ovex = reinterpret_cast<OverlappedFsListDir *>(ov);
+          ovex->awaitable->io_listed(ovex);
+        } break;
+
+        case FsIoType::Stat: {
+          auto ovex = reinterpret_cast<OverlappedFsStat *>(ov);
+          ovex->awaitable->io_stat();
+        } break;
+        }
+      } break;
+
+      case AsyncIoType::Dns: {
+        auto lookup = std::bit_cast<DnsLookup *>(completion_key);
+        lookup->cache->impl->io_resolved(*lookup->cache, lookup);
       } break;
 
       case AsyncIoType::TcpSocket: {
@@ -150,6 +201,16 @@ auto TaskScheduler::execute() -> void {
           ovex->awaitable->io_received(bytes_transferred);
         } break;
 
+        case TcpIoType::AcceptStream: {
+          auto ovex = reinterpret_cast<OverlappedTcpAcceptStream *>(ov);
+          if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            ovex->stream->io_failed(ovex->slot, err_code);
+            continue;
+          }
+          ovex->stream->io_accepted(ovex->slot);
+        } break;
+
         case TcpIoType::Connect: {
           auto ovex = reinterpret_cast<OverlappedTcpConnect *>(ov);
           if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
@@ -196,6 +257,52 @@ auto TaskScheduler::execute() -> void {
           ovex->awaitable->io_received(bytes_transferred);
         } break;
 
+        case TcpIoType::RecvV: {
+          auto ovex = reinterpret_cast<OverlappedTcpRecvV *>(ov);
+          if (ovex->awaitable->timer.ended) {
+            // timeout
+            continue;
+          }
+          if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            if (err_code == WSA_OPERATION_ABORTED and ovex->awaitable->timer.ended) {
+              // timeout
+              continue;
+            }
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_received(bytes_transferred);
+        } break;
+
+        case TcpIoType::RecvPooled: {
+          auto ovex = reinterpret_cast<OverlappedTcpRecvPooled *>(ov);
+          if (ovex->awaitable->timer.ended) {
+            // timeout
+            continue;
+          }
+          if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            if (err_code == WSA_OPERATION_ABORTED and ovex->awaitable->timer.ended) {
+              // timeout
+              continue;
+            }
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_received(bytes_transferred);
+        } break;
+
+        case TcpIoType::RecvStream: {
+          auto ovex = reinterpret_cast<OverlappedTcpRecvStream *>(ov);
+          if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            ovex->stream->io_failed(err_code);
+            continue;
+          }
+          ovex->stream->io_received(bytes_transferred);
+        } break;
+
         case TcpIoType::Send: {
           auto ovex = reinterpret_cast<OverlappedTcpSend *>(ov);
           if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
@@ -215,6 +322,87 @@ auto TaskScheduler::execute() -> void {
           }
           ovex->awaitable->io_sent(bytes_transferred);
         } break;
+
+        case TcpIoType::SendZeroCopy: {
+          auto ovex = reinterpret_cast<OverlappedTcpSendZeroCopy *>(ov);
+          if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_sent(bytes_transferred);
+        } break;
+
+        case TcpIoType::SendV: {
+          auto ovex = reinterpret_cast<OverlappedTcpSendV *>(ov);
+          if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_sent(bytes_transferred);
+        } break;
+
+        case TcpIoType::SendFile: {
+          auto ovex = reinterpret_cast<OverlappedTcpSendFile *>(ov);
+          if (ovex->awaitable->timer.ended) {
+            // timeout
+            continue;
+          }
+          if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            if (err_code == WSA_OPERATION_ABORTED and ovex->awaitable->timer.ended) {
+              // timeout
+              continue;
+            }
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_sent(bytes_transferred);
+        } break;
+
+        case TcpIoType::UnixAccept: {
+          auto ovex = reinterpret_cast<OverlappedTcpUnixAccept *>(ov);
+          if (not ::WSAGetOverlappedResult(tcp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_accepted(bytes_transferred);
+        } break;
+
+        case TcpIoType::UnixConnect: {
+          auto ovex = reinterpret_cast<OverlappedTcpUnixConnect *>(ov);
+          ovex->awaitable->io_connected();
+        } break;
+        }
+      } break;
+
+      case AsyncIoType::UdpSocket: {
+        auto udp_socket = std::bit_cast<UdpSocket *>(completion_key);
+        auto ov = reinterpret_cast<OverlappedUdp *>(overlapped);
+        auto flags = DWORD{};
+
+        switch (ov->type) {
+        case UdpIoType::RecvBatch: {
+          auto ovex = reinterpret_cast<OverlappedUdpRecvBatch *>(ov);
+          if (not ::WSAGetOverlappedResult(udp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_received(bytes_transferred);
+        } break;
+
+        case UdpIoType::SendBatch: {
+          auto ovex = reinterpret_cast<OverlappedUdpSendBatch *>(ov);
+          if (not ::WSAGetOverlappedResult(udp_socket->impl->socket, overlapped, &n, TRUE, &flags)) {
+            const auto err_code = ::GetLastError();
+            ovex->awaitable->io_failed(err_code);
+            continue;
+          }
+          ovex->awaitable->io_sent(bytes_transferred);
+        } break;
         }
       } break;
       }
@@ -226,6 +414,12 @@ auto TaskScheduler::execute() -> void {
     cohandle.destroy();
   }
   top_level_tasks.clear();
+
+  // detached coroutines that have not ended
+  for (auto address : detached_tasks) {
+    std::coroutine_handle<>::from_address(address).destroy();
+  }
+  detached_tasks.clear();
 }
 
 } // namespace cotask
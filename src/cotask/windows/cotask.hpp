@@ -11,6 +11,10 @@ struct OverlappedTcp : public OVERLAPPED {
   const TcpIoType type;
 };
 
+struct OverlappedUdp : public OVERLAPPED {
+  const UdpIoType type;
+};
+
 struct TaskScheduler::Impl {
   HANDLE iocp_handle = nullptr;
 };
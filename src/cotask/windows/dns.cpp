@@ -0,0 +1,147 @@
+#include "dns.hpp"
+
+#include <cotask/impl.hpp>
+#include <cotask/utils.hpp>
+
+#include <iostream>
+
+#include <ws2tcpip.h>
+
+namespace cotask {
+
+DnsCache::DnsCache() {
+  IMPL_CONSTRUCT();
+}
+
+DnsCache::~DnsCache() {
+  for (auto &[key, lookup] : impl->lookups) {
+    ::WaitForThreadpoolWorkCallbacks(lookup->work, FALSE);
+    ::CloseThreadpoolWork(lookup->work);
+  }
+  std::destroy_at(impl);
+}
+
+auto DnsCache::size() const -> std::size_t {
+  return impl->entries.size();
+}
+
+auto DnsCache::invalidate(std::string_view host, std::string_view port) -> void {
+  impl->entries.erase(Impl::make_key(host, port));
+}
+
+auto DnsCache::clear() -> void {
+  impl->entries.clear();
+}
+
+auto DnsCache::Impl::resolve(DnsCache &cache, HANDLE iocp_handle, std::string_view host, std::string_view port,
+                             const void *owner, std::function<void(const DnsEntry &)> on_resolved) -> bool {
+  auto key = make_key(host, port);
+
+  // cached
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    if (std::chrono::steady_clock::now() < it->second.expires) {
+      if (it->second.addrs.empty()) {
+        cache.stats.negative_hits += 1;
+      } else {
+        cache.stats.hits += 1;
+      }
+      on_resolved(it->second);
+      return true;
+    }
+    cache.stats.expirations += 1;
+    entries.erase(it);
+  }
+
+  // in flight
+  auto lookup_it = lookups.find(key);
+  if (lookup_it != lookups.end()) {
+    cache.stats.coalesced += 1;
+    lookup_it->second->waiters.push_back({owner, std::move(on_resolved)});
+    return true;
+  }
+
+  // getaddrinfo blocks, run it on the worker pool
+  cache.stats.misses += 1;
+  auto lookup = std::make_unique<DnsLookup>(&cache, key, host, port);
+  lookup->iocp_handle = iocp_handle;
+  lookup->work = ::CreateThreadpoolWork(
+    [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+      auto lookup = static_cast<DnsLookup *>(context);
+
+      auto addr_list = PADDRINFOA{};
+      auto addr_hints = addrinfo{};
+      addr_hints.ai_family = AF_INET;
+      addr_hints.ai_socktype = SOCK_STREAM;
+      addr_hints.ai_protocol = IPPROTO_TCP;
+
+      lookup->entry.err_code = ::getaddrinfo(lookup->host.c_str(), lookup->port.c_str(), &addr_hints, &addr_list);
+      if (lookup->entry.err_code == 0) {
+        for (auto addr = addr_list; addr != nullptr; addr = addr->ai_next) {
+          lookup->entry.addrs.push_back(*reinterpret_cast<SOCKADDR_IN *>(addr->ai_addr));
+        }
+        ::freeaddrinfo(addr_list);
+      }
+
+      ::PostQueuedCompletionStatus(lookup->iocp_handle, 0, std::bit_cast<ULONG_PTR>(lookup), nullptr);
+    },
+    lookup.get(), nullptr);
+
+  if (lookup->work == nullptr) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("CreateThreadpoolWork failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  lookup->waiters.push_back({owner, std::move(on_resolved)});
+  ::SubmitThreadpoolWork(lookup->work);
+  lookups.emplace(std::move(key), std::move(lookup));
+  return true;
+}
+
+auto DnsCache::Impl::cancel(const void *owner) -> void {
+  for (auto &[key, lookup] : lookups) {
+    std::erase_if(lookup->waiters, [owner](const auto &waiter) { return waiter.owner == owner; });
+  }
+}
+
+auto DnsCache::Impl::io_resolved(DnsCache &cache, DnsLookup *lookup) -> void {
+  auto it = lookups.find(lookup->key);
+  assert(it != lookups.end());
+  auto owned = std::move(it->second);
+  lookups.erase(it);
+
+  ::WaitForThreadpoolWorkCallbacks(owned->work, FALSE);
+  ::CloseThreadpoolWork(owned->work);
+
+  auto &entry = owned->entry;
+  if (entry.err_code != 0) {
+    std::cerr << utils::with_location(std::format("getaddrinfo failed for \"{}\": {}", owned->key, entry.err_code))
+              << std::format("err msg: {}\n", ::gai_strerrorA(entry.err_code));
+  }
+  entry.expires = std::chrono::steady_clock::now() + (entry.addrs.empty() ? cache.negative_ttl : cache.ttl);
+
+  evict(cache);
+  entries.insert_or_assign(owned->key, entry);
+
+  for (auto &waiter : owned->waiters) {
+    waiter.on_resolved(entry);
+  }
+}
+
+auto DnsCache::Impl::evict(DnsCache &cache) -> void {
+  if (entries.size() < cache.max_entries) {
+    return;
+  }
+
+  // expired answers first
+  const auto now = std::chrono::steady_clock::now();
+  std::erase_if(entries, [&](const auto &item) { return item.second.expires <= now; });
+
+  while (not entries.empty() and entries.size() >= cache.max_entries) {
+    entries.erase(entries.begin());
+  }
+}
+
+} // namespace cotask
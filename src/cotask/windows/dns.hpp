@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cotask/dns.hpp>
+
+#include "cotask.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include <winsock2.h>
+
+namespace cotask {
+
+struct DnsEntry {
+  std::vector<SOCKADDR_IN> addrs; // empty: negative answer
+  int err_code = 0;
+  std::chrono::steady_clock::time_point expires;
+};
+
+struct DnsWaiter {
+  const void *owner; // the awaitable, removed again by `DnsCache::Impl::cancel`
+  std::function<void(const DnsEntry &)> on_resolved;
+};
+
+// getaddrinfo running on the worker pool, the completion key of its completion
+struct DnsLookup {
+  const AsyncIoType type = AsyncIoType::Dns;
+  DnsCache *cache;
+  std::string key;
+  std::string host;
+  std::string port;
+
+  HANDLE iocp_handle = nullptr;
+  PTP_WORK work = nullptr;
+  DnsEntry entry;
+
+  // connects waiting for this lookup
+  std::vector<DnsWaiter> waiters;
+
+  inline DnsLookup(DnsCache *cache, std::string key, std::string_view host, std::string_view port)
+      : cache{cache}, key{std::move(key)}, host{host}, port{port} {}
+};
+
+struct DnsCache::Impl {
+  std::unordered_map<std::string, DnsEntry> entries;
+  std::unordered_map<std::string, std::unique_ptr<DnsLookup>> lookups; // in flight
+
+  [[nodiscard]] static inline auto make_key(std::string_view host, std::string_view port) -> std::string {
+    auto key = std::string{host};
+    key += ':';
+    key += port;
+    return key;
+  }
+
+  // calls `on_resolved` right away on a fresh cached answer, else once the lookup completes
+  auto resolve(DnsCache &cache, HANDLE iocp_handle, std::string_view host, std::string_view port, const void *owner,
+               std::function<void(const DnsEntry &)> on_resolved) -> bool;
+  // drops the callbacks of `owner` (destroyed before its lookup completed), the lookup itself keeps running
+  auto cancel(const void *owner) -> void;
+  auto io_resolved(DnsCache &cache, DnsLookup *lookup) -> void;
+  auto evict(DnsCache &cache) -> void;
+};
+
+} // namespace cotask
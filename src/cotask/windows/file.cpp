@@ -4,20 +4,40 @@
 #include <cotask/impl.hpp>
 #include <cotask/utils.hpp>
 
+#include <bit>
+#include <cstring>
 #include <iostream>
 
 namespace cotask {
 
-FileReadBuf::FileReadBuf(TaskScheduler &ts, FileReader *reader, std::span<char> buf, std::uint64_t offset)
-    : ts{ts}, reader{reader}, buf{buf}, offset{offset} {
+FileReadBuf::FileReadBuf(TaskScheduler &ts, FileReader *reader, std::span<char> buf, std::uint64_t offset,
+                         Checksum checksum)
+    : ts{ts}, reader{reader}, buf{buf}, offset{offset}, checksum{checksum} {
   IMPL_CONSTRUCT(this);
 
+  auto read_offset = offset;
+  auto read_buf = buf;
+
+  // direct reads must be sector aligned, read the enclosing aligned range instead
+  if (reader->mode == FileReadMode::Direct) {
+    const auto is_aligned = AlignedBufferPool::is_aligned(buf.data()) and
+                            offset == AlignedBufferPool::align_down(offset) and
+                            buf.size() == AlignedBufferPool::align_down(buf.size());
+    if (not is_aligned) {
+      bounce_offset = AlignedBufferPool::align_down(offset);
+      const auto bounce_size = AlignedBufferPool::align_up(offset + buf.size()) - bounce_offset;
+      bounce = ts.aligned_buffers.acquire(static_cast<std::size_t>(bounce_size));
+      read_offset = bounce_offset;
+      read_buf = {bounce.buf.data(), static_cast<std::size_t>(bounce_size)};
+    }
+  }
+
   // setup OVERLAPPED
-  impl->ovex.Offset = static_cast<std::uint32_t>(offset);           // low 32bits
-  impl->ovex.OffsetHigh = static_cast<std::uint32_t>(offset >> 32); // high 32bits
+  impl->ovex.Offset = static_cast<std::uint32_t>(read_offset);           // low 32bits
+  impl->ovex.OffsetHigh = static_cast<std::uint32_t>(read_offset >> 32); // high 32bits
 
   // read file
-  auto read_success = ::ReadFile(reader->impl->file_handle, buf.data(), static_cast<DWORD>(buf.size()),
+  auto read_success = ::ReadFile(reader->impl->file_handle, read_buf.data(), static_cast<DWORD>(read_buf.size()),
                                  reinterpret_cast<DWORD *>(&bytes_read), &impl->ovex);
   const auto err_code = ::GetLastError();
   if (not read_success and err_code != ERROR_IO_PENDING) {
@@ -35,6 +55,15 @@ FileReadBuf::~FileReadBuf() {
 }
 
 auto FileReadBuf::io_read(std::uint32_t bytes_read) -> void {
+  // copy the requested range out of the aligned range
+  if (not bounce.empty()) {
+    const auto skip = static_cast<std::uint32_t>(offset - bounce_offset);
+    const auto remain = bytes_read > skip ? bytes_read - skip : 0;
+    bytes_read = remain < buf.size() ? remain : static_cast<std::uint32_t>(buf.size());
+    std::memcpy(buf.data(), bounce.buf.data() + skip, bytes_read);
+    bounce.release();
+  }
+
   // check finished
   if (bytes_read <= buf.size()) {
     if (is_waiting != nullptr) {
@@ -42,6 +71,9 @@ auto FileReadBuf::io_read(std::uint32_t bytes_read) -> void {
     }
     finished = true;
     buf = {buf.data(), bytes_read};
+    if (checksum == Checksum::Crc32c) {
+      crc.update(buf);
+    }
   }
 }
 
@@ -56,13 +88,23 @@ auto FileReadBuf::io_failed(std::uint32_t err_code) -> void {
             << std::format("err msg: {}\n", std::system_category().message((int)err_code));
 }
 
-FileReadAll::FileReadAll(TaskScheduler &ts, FileReader *reader, std::size_t offset)
-    : ts{ts}, reader{reader}, offset{offset} {
+FileReadAll::FileReadAll(TaskScheduler &ts, FileReader *reader, std::size_t offset, Checksum checksum)
+    : ts{ts}, reader{reader}, offset{offset}, checksum{checksum} {
   IMPL_CONSTRUCT(this);
 
+  io_buf = buf;
+
+  // direct reads must be sector aligned, start from the enclosing aligned offset
+  if (reader->mode == FileReadMode::Direct) {
+    bounce = ts.aligned_buffers.acquire(64 * 1024);
+    io_buf = bounce.buf;
+    skip = static_cast<std::size_t>(offset - AlignedBufferPool::align_down(offset));
+    this->offset = AlignedBufferPool::align_down(offset);
+  }
+
   // setup OVERLAPPED
-  impl->ovex.Offset = static_cast<std::uint32_t>(offset);           // low 32bits
-  impl->ovex.OffsetHigh = static_cast<std::uint32_t>(offset >> 32); // high 32bits
+  impl->ovex.Offset = static_cast<std::uint32_t>(this->offset);           // low 32bits
+  impl->ovex.OffsetHigh = static_cast<std::uint32_t>(this->offset >> 32); // high 32bits
 
   // read file
   if (not io_request()) {
@@ -77,7 +119,7 @@ FileReadAll::~FileReadAll() {
 }
 
 auto FileReadAll::io_request() -> bool {
-  auto read_success = ::ReadFile(reader->impl->file_handle, buf.data(), static_cast<DWORD>(buf.size()),
+  auto read_success = ::ReadFile(reader->impl->file_handle, io_buf.data(), static_cast<DWORD>(io_buf.size()),
                                  reinterpret_cast<DWORD *>(&bytes_read), &impl->ovex);
   const auto err_code = ::GetLastError();
   if (not read_success and err_code != ERROR_IO_PENDING) {
@@ -97,15 +139,22 @@ auto FileReadAll::io_read(std::uint32_t bytes_read) -> void {
   offset += bytes_read;
   impl->ovex.Offset = static_cast<std::uint32_t>(offset);           // low 32bits
   impl->ovex.OffsetHigh = static_cast<std::uint32_t>(offset >> 32); // high 32bits
-  content.insert(content.end(), buf.data(), buf.data() + bytes_read);
+  if (bytes_read > skip) {
+    content.insert(content.end(), io_buf.data() + skip, io_buf.data() + bytes_read);
+    if (checksum == Checksum::Crc32c) {
+      crc.update({io_buf.data() + skip, bytes_read - skip});
+    }
+  }
+  skip = 0;
 
   // check finished
-  if (bytes_read < buf.size()) {
+  if (bytes_read < io_buf.size()) {
     if (is_waiting != nullptr) {
       *is_waiting = false;
     }
     finished = true;
     success = true;
+    bounce.release();
     return;
   }
 
@@ -128,31 +177,67 @@ auto FileReadAll::io_failed(std::uint32_t err_code) -> void {
             << std::format("err msg: {}\n", std::system_category().message((int)err_code));
 }
 
-FileReader::FileReader(TaskScheduler &ts, const std::filesystem::path &path) : ts{ts}, path{path} {
-  IMPL_CONSTRUCT();
+static auto open_file(const std::filesystem::path &path, FileReadMode mode, bool cached = false) -> HANDLE {
+  auto flags = DWORD{FILE_FLAG_OVERLAPPED};
+  if (mode == FileReadMode::Direct) {
+    flags |= FILE_FLAG_NO_BUFFERING;
+  }
 
-  // open file
-  impl->file_handle =
-    ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+  // a cached handle stays open while idle, it must not block writers, renames or deletes of the file
+  // (the change is noticed by the validation on hit)
+  const auto share_mode =
+    cached ? DWORD{FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE} : DWORD{FILE_SHARE_READ};
 
-  if (impl->file_handle == nullptr) {
+  // open file
+  auto file_handle = ::CreateFileW(path.c_str(), GENERIC_READ, share_mode, nullptr, OPEN_EXISTING, flags, nullptr);
+  if (file_handle == INVALID_HANDLE_VALUE) {
     const auto err_code = ::GetLastError();
 
     auto path_str = std::filesystem::absolute(path).string();
     std::cerr << utils::with_location(std::format("CreateFileW failed for \"{}\": {}", path_str, err_code))
               << std::format("err msg: {}\n", std::system_category().message((int)err_code));
-    return;
+    return nullptr;
   }
 
+  return file_handle;
+}
+
+static auto associate_file(const std::filesystem::path &path, HANDLE file_handle, HANDLE iocp_handle,
+                           ULONG_PTR completion_key) -> bool {
   // setup IOCP
-  if (::CreateIoCompletionPort(impl->file_handle, ts.impl->iocp_handle, (ULONG_PTR)this, 0) == nullptr) {
+  if (::CreateIoCompletionPort(file_handle, iocp_handle, completion_key, 0) == nullptr) {
     const auto err_code = ::GetLastError();
-    ::CloseHandle(impl->file_handle);
-    impl->file_handle = nullptr;
 
     auto path_str = std::filesystem::absolute(path).string();
     std::cerr << utils::with_location(std::format("CreateIoCompletionPort failed for \"{}\": {}", path_str, err_code))
               << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  return true;
+}
+
+FileReader::FileReader(TaskScheduler &ts, const std::filesystem::path &path, FileReadMode mode)
+    : ts{ts}, path{path}, mode{mode} {
+  IMPL_CONSTRUCT();
+
+  // lease a cached handle
+  if (ts.file_handles.enabled()) {
+    impl->entry = ts.file_handles.impl->acquire(ts.file_handles, path, mode, ts.impl->iocp_handle);
+    if (impl->entry != nullptr) {
+      impl->file_handle = impl->entry->file_handle;
+    }
+    return;
+  }
+
+  impl->file_handle = open_file(path, mode);
+  if (impl->file_handle == nullptr) {
+    return;
+  }
+
+  if (not associate_file(path, impl->file_handle, ts.impl->iocp_handle, (ULONG_PTR)this)) {
+    ::CloseHandle(impl->file_handle);
+    impl->file_handle = nullptr;
   }
 }
 
@@ -161,8 +246,505 @@ FileReader::~FileReader() {
 }
 
 auto FileReader::close() -> void {
+  if (impl->entry != nullptr) {
+    ts.file_handles.impl->release(ts.file_handles, impl->entry);
+    impl->entry = nullptr;
+  } else if (impl->file_handle != nullptr) {
+    ::CloseHandle(impl->file_handle);
+  }
+  impl->file_handle = nullptr;
+}
+
+} // namespace cotask
+
+// FileWriter
+namespace cotask {
+
+FileWriteBuf::FileWriteBuf(TaskScheduler &ts, FileWriter *writer, std::span<const char> buf, std::uint64_t offset)
+    : ts{ts}, writer{writer}, buf{buf}, offset{offset} {
+  IMPL_CONSTRUCT(this);
+
+  if (buf.empty()) {
+    finished = true;
+    success = true;
+    return;
+  }
+
+  // write file
+  if (not io_request()) {
+    return;
+  }
+
+  success = true;
+}
+
+FileWriteBuf::~FileWriteBuf() {
+  std::destroy_at(impl);
+}
+
+auto FileWriteBuf::io_request() -> bool {
+  // setup OVERLAPPED
+  const auto write_offset = offset + total_bytes_written;
+  impl->ovex.Offset = static_cast<std::uint32_t>(write_offset);           // low 32bits
+  impl->ovex.OffsetHigh = static_cast<std::uint32_t>(write_offset >> 32); // high 32bits
+
+  auto write_success =
+    ::WriteFile(writer->impl->file_handle, buf.data() + total_bytes_written,
+                static_cast<DWORD>(buf.size() - total_bytes_written), reinterpret_cast<DWORD *>(&bytes_written),
+                &impl->ovex);
+  const auto err_code = ::GetLastError();
+  if (not write_success and err_code != ERROR_IO_PENDING) {
+    success = false;
+
+    auto path_str = std::filesystem::absolute(writer->path).string();
+    std::cerr << utils::with_location(std::format("WriteFile failed for \"{}\": {}", path_str, err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  return true;
+}
+
+auto FileWriteBuf::io_written(std::uint32_t bytes_written) -> void {
+  total_bytes_written += bytes_written;
+
+  // check finished
+  if (total_bytes_written == buf.size()) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = true;
+    return;
+  }
+
+  // write more bytes
+  if (not io_request()) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = false;
+  }
+}
+
+auto FileWriteBuf::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  std::cerr << utils::with_location(std::format("FileWriteBuf compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+FileFlush::FileFlush(TaskScheduler &ts, FileWriter *writer) : ts{ts}, writer{writer} {
+  IMPL_CONSTRUCT(this);
+
+  // FlushFileBuffers blocks, run it on the worker pool
+  impl->ovex.iocp_handle = ts.impl->iocp_handle;
+  impl->ovex.work = ::CreateThreadpoolWork(
+    [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+      auto ovex = static_cast<OverlappedFileFlush *>(context);
+      auto writer = ovex->awaitable->writer;
+
+      if (not ::FlushFileBuffers(writer->impl->file_handle)) {
+        ovex->err_code = ::GetLastError();
+      }
+
+      ::PostQueuedCompletionStatus(ovex->iocp_handle, 0, std::bit_cast<ULONG_PTR>(writer), ovex);
+    },
+    &impl->ovex, nullptr);
+
+  if (impl->ovex.work == nullptr) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("CreateThreadpoolWork failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return;
+  }
+
+  ::SubmitThreadpoolWork(impl->ovex.work);
+  success = true;
+}
+
+FileFlush::~FileFlush() {
+  if (impl->ovex.work != nullptr) {
+    ::WaitForThreadpoolWorkCallbacks(impl->ovex.work, FALSE);
+    ::CloseThreadpoolWork(impl->ovex.work);
+  }
+  std::destroy_at(impl);
+}
+
+auto FileFlush::io_flushed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = err_code == 0;
+
+  if (err_code != 0) {
+    auto path_str = std::filesystem::absolute(writer->path).string();
+    std::cerr << utils::with_location(std::format("FlushFileBuffers failed for \"{}\": {}", path_str, err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+  }
+}
+
+FileWriter::FileWriter(TaskScheduler &ts, const std::filesystem::path &path, FileWriteMode mode)
+    : ts{ts}, path{path} {
+  IMPL_CONSTRUCT();
+
+  const auto disposition = mode == FileWriteMode::Append ? DWORD{OPEN_ALWAYS} : DWORD{CREATE_ALWAYS};
+
+  // open file
+  auto file_handle = ::CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, disposition,
+                                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+  if (file_handle == INVALID_HANDLE_VALUE) {
+    const auto err_code = ::GetLastError();
+
+    auto path_str = std::filesystem::absolute(path).string();
+    std::cerr << utils::with_location(std::format("CreateFileW failed for \"{}\": {}", path_str, err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return;
+  }
+
+  // append after the existing content
+  auto file_size = LARGE_INTEGER{};
+  if (::GetFileSizeEx(file_handle, &file_size)) {
+    size = static_cast<std::uint64_t>(file_size.QuadPart);
+  }
+
+  if (not associate_file(path, file_handle, ts.impl->iocp_handle, (ULONG_PTR)this)) {
+    ::CloseHandle(file_handle);
+    return;
+  }
+
+  impl->file_handle = file_handle;
+}
+
+FileWriter::~FileWriter() {
+  std::destroy_at(impl);
+}
+
+auto FileWriter::is_open() const -> bool {
+  return impl->file_handle != nullptr;
+}
+
+auto FileWriter::close() -> void {
   if (impl->file_handle != nullptr) {
     ::CloseHandle(impl->file_handle);
+    impl->file_handle = nullptr;
+  }
+}
+
+} // namespace cotask
+
+// MappedFile
+namespace cotask {
+
+MappedFile::MappedFile(const std::filesystem::path &path, std::uint64_t offset, std::size_t size,
+                       FileAccessHint hint)
+    : path{path} {
+  IMPL_CONSTRUCT();
+
+  auto flags = DWORD{FILE_ATTRIBUTE_NORMAL};
+  switch (hint) {
+  case FileAccessHint::Normal:
+    break;
+  case FileAccessHint::Sequential:
+    flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    break;
+  case FileAccessHint::Random:
+    flags |= FILE_FLAG_RANDOM_ACCESS;
+    break;
+  }
+
+  auto mapping = std::make_shared<FileMapping>();
+
+  // open file
+  mapping->file_handle =
+    ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+  if (mapping->file_handle == INVALID_HANDLE_VALUE) {
+    const auto err_code = ::GetLastError();
+    mapping->file_handle = nullptr;
+
+    auto path_str = std::filesystem::absolute(path).string();
+    std::cerr << utils::with_location(std::format("CreateFileW failed for \"{}\": {}", path_str, err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return;
+  }
+
+  // clamp window to the file size
+  auto file_size = LARGE_INTEGER{};
+  if (not ::GetFileSizeEx(mapping->file_handle, &file_size)) {
+    const auto err_code = ::GetLastError();
+
+    auto path_str = std::filesystem::absolute(path).string();
+    std::cerr << utils::with_location(std::format("GetFileSizeEx failed for \"{}\": {}", path_str, err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return;
+  }
+  const auto total_size = static_cast<std::uint64_t>(file_size.QuadPart);
+  if (offset >= total_size) {
+    // empty window (CreateFileMappingW can not map an empty file)
+    return;
+  }
+  if (size == 0 or size > total_size - offset) {
+    size = static_cast<std::size_t>(total_size - offset);
+  }
+
+  // create mapping
+  mapping->mapping_handle = ::CreateFileMappingW(mapping->file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping->mapping_handle == nullptr) {
+    const auto err_code = ::GetLastError();
+
+    auto path_str = std::filesystem::absolute(path).string();
+    std::cerr << utils::with_location(std::format("CreateFileMappingW failed for \"{}\": {}", path_str, err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return;
+  }
+
+  // view offset must be a multiple of the allocation granularity
+  auto sys_info = SYSTEM_INFO{};
+  ::GetSystemInfo(&sys_info);
+  const auto view_offset = offset - offset % sys_info.dwAllocationGranularity;
+  const auto view_delta = static_cast<std::size_t>(offset - view_offset);
+
+  // map view
+  mapping->view = ::MapViewOfFile(mapping->mapping_handle, FILE_MAP_READ, static_cast<DWORD>(view_offset >> 32),
+                                  static_cast<DWORD>(view_offset), view_delta + size);
+  if (mapping->view == nullptr) {
+    const auto err_code = ::GetLastError();
+
+    auto path_str = std::filesystem::absolute(path).string();
+    std::cerr << utils::with_location(std::format("MapViewOfFile failed for \"{}\": {}", path_str, err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return;
+  }
+
+  impl->data = {static_cast<const char *>(mapping->view) + view_delta, size};
+  impl->mapping = std::move(mapping);
+
+  if (hint == FileAccessHint::Sequential) {
+    prefetch(0, size);
+  }
+}
+
+MappedFile::MappedFile(const MappedFile &other) : path{other.path} {
+  IMPL_COPY(*other.impl);
+}
+
+MappedFile::~MappedFile() {
+  std::destroy_at(impl);
+}
+
+auto MappedFile::operator=(const MappedFile &other) -> MappedFile & {
+  if (this == &other) {
+    return *this;
+  }
+  this->path = other.path;
+  *this->impl = *other.impl;
+  return *this;
+}
+
+auto MappedFile::is_open() const -> bool {
+  return impl->mapping != nullptr;
+}
+
+auto MappedFile::data() const -> std::span<const char> {
+  return impl->data;
+}
+
+auto MappedFile::read(std::size_t offset, std::size_t size) const -> std::span<const char> {
+  if (offset >= impl->data.size()) {
+    return {};
+  }
+  const auto remain = impl->data.size() - offset;
+  return impl->data.subspan(offset, size < remain ? size : remain);
+}
+
+auto MappedFile::prefetch(std::size_t offset, std::size_t size) const -> bool {
+  const auto range = read(offset, size);
+  if (range.empty()) {
+    return false;
+  }
+
+  auto entry = WIN32_MEMORY_RANGE_ENTRY{
+    .VirtualAddress = const_cast<char *>(range.data()),
+    .NumberOfBytes = range.size(),
+  };
+  if (not ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &entry, 0)) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("PrefetchVirtualMemory failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  return true;
+}
+
+auto MappedFile::close() -> void {
+  impl->mapping.reset();
+  impl->data = {};
+}
+
+} // namespace cotask
+
+// FileHandleCache
+namespace cotask {
+
+static auto get_file_info(const std::filesystem::path &path, std::uint64_t &size, std::uint64_t &last_write_time)
+  -> bool {
+  auto data = WIN32_FILE_ATTRIBUTE_DATA{};
+  if (not ::GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) {
+    return false;
+  }
+  size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+  last_write_time = (static_cast<std::uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+                    data.ftLastWriteTime.dwLowDateTime;
+  return true;
+}
+
+FileHandleCache::FileHandleCache(std::size_t capacity) : capacity{capacity} {
+  IMPL_CONSTRUCT();
+}
+
+FileHandleCache::~FileHandleCache() {
+  for (auto &[key, entry] : impl->entries) {
+    ::CloseHandle(entry->file_handle);
+  }
+  for (auto &entry : impl->stale) {
+    ::CloseHandle(entry->file_handle);
+  }
+  std::destroy_at(impl);
+}
+
+auto FileHandleCache::size() const -> std::size_t {
+  return impl->entries.size();
+}
+
+auto FileHandleCache::set_capacity(std::size_t capacity) -> void {
+  this->capacity = capacity;
+  impl->evict(*this);
+}
+
+auto FileHandleCache::invalidate(const std::filesystem::path &path) -> void {
+  for (const auto mode : {FileReadMode::Buffered, FileReadMode::Direct}) {
+    auto it = impl->entries.find(FileHandleKey{path, mode});
+    if (it != impl->entries.end()) {
+      stats.invalidations += 1;
+      impl->drop(*this, it);
+    }
+  }
+}
+
+auto FileHandleCache::clear() -> void {
+  while (not impl->entries.empty()) {
+    impl->drop(*this, impl->entries.begin());
+  }
+}
+
+auto FileHandleCache::Impl::acquire(FileHandleCache &cache, const std::filesystem::path &path, FileReadMode mode,
+                                    HANDLE iocp_handle) -> FileHandleEntry * {
+  auto key = FileHandleKey{path, mode};
+
+  // lookup
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    auto entry = it->second.get();
+
+    // the path lookup costs about as much as the open it saves, so it is done at most every validate_interval
+    const auto now = std::chrono::steady_clock::now();
+    const auto validate = cache.validate_on_hit and
+                          now - entry->validated_at >= std::chrono::milliseconds{cache.validate_interval};
+    auto size = std::uint64_t{};
+    auto last_write_time = std::uint64_t{};
+    const auto changed = validate and (not get_file_info(path, size, last_write_time) or size != entry->size or
+                                       last_write_time != entry->last_write_time);
+    if (validate and not changed) {
+      entry->validated_at = now;
+    }
+    if (not changed) {
+      cache.stats.hits += 1;
+      if (entry->leases == 0) {
+        idle.erase(entry->lru_it);
+      }
+      entry->leases += 1;
+      return entry;
+    }
+
+    // file changed since it was opened
+    cache.stats.invalidations += 1;
+    drop(cache, it);
+  }
+  cache.stats.misses += 1;
+
+  // open
+  auto entry = std::make_unique<FileHandleEntry>();
+  entry->path = path;
+  entry->mode = mode;
+  entry->file_handle = open_file(path, mode, true);
+  if (entry->file_handle == nullptr) {
+    return nullptr;
+  }
+  if (not associate_file(path, entry->file_handle, iocp_handle, std::bit_cast<ULONG_PTR>(entry.get()))) {
+    ::CloseHandle(entry->file_handle);
+    return nullptr;
+  }
+  get_file_info(path, entry->size, entry->last_write_time);
+  entry->validated_at = std::chrono::steady_clock::now();
+  entry->leases = 1;
+
+  auto result = entry.get();
+  entries.emplace(std::move(key), std::move(entry));
+  evict(cache);
+  return result;
+}
+
+auto FileHandleCache::Impl::release(FileHandleCache &cache, FileHandleEntry *entry) -> void {
+  entry->leases -= 1;
+  if (entry->leases != 0) {
+    return;
+  }
+
+  // invalidated while leased
+  if (entry->stale) {
+    ::CloseHandle(entry->file_handle);
+    for (auto &stale_entry : stale) {
+      if (stale_entry.get() == entry) {
+        std::swap(stale_entry, stale.back());
+        stale.pop_back();
+        break;
+      }
+    }
+    return;
+  }
+
+  idle.push_front(entry);
+  entry->lru_it = idle.begin();
+  evict(cache);
+}
+
+auto FileHandleCache::Impl::drop(FileHandleCache &, decltype(entries)::iterator it) -> void {
+  auto &entry = it->second;
+  if (entry->leases == 0) {
+    idle.erase(entry->lru_it);
+    ::CloseHandle(entry->file_handle);
+  } else {
+    entry->stale = true;
+    stale.push_back(std::move(entry));
+  }
+  entries.erase(it);
+}
+
+auto FileHandleCache::Impl::evict(FileHandleCache &cache) -> void {
+  // only idle handles are closed, leased handles may exceed the capacity
+  while (entries.size() > cache.capacity and not idle.empty()) {
+    auto entry = idle.back();
+    idle.pop_back();
+    ::CloseHandle(entry->file_handle);
+    entries.erase(FileHandleKey{entry->path, entry->mode});
+    cache.stats.evictions += 1;
   }
 }
 
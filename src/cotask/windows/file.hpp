@@ -2,6 +2,12 @@
 
 #include <cotask/file.hpp>
 
+#include <list>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
@@ -17,6 +23,75 @@ namespace cotask {
 
 struct FileReader::Impl {
   HANDLE file_handle = nullptr;
+  FileHandleEntry *entry = nullptr; // set when the handle is leased from `FileHandleCache`
+};
+
+struct FileHandleEntry {
+  const AsyncIoType type = AsyncIoType::FileRead; // completion key of the cached handle
+  HANDLE file_handle = nullptr;
+
+  std::filesystem::path path;
+  FileReadMode mode = FileReadMode::Buffered;
+  std::uint64_t size = 0;
+  std::uint64_t last_write_time = 0;
+  std::chrono::steady_clock::time_point validated_at;
+
+  std::size_t leases = 0;
+  bool stale = false;
+  std::list<FileHandleEntry *>::iterator lru_it;
+};
+
+struct FileHandleKey {
+  std::filesystem::path path;
+  FileReadMode mode;
+
+  inline auto operator==(const FileHandleKey &other) const -> bool {
+    return mode == other.mode and path == other.path;
+  }
+};
+
+struct FileHandleKeyHash {
+  inline auto operator()(const FileHandleKey &key) const -> std::size_t {
+    return std::filesystem::hash_value(key.path) ^ (static_cast<std::size_t>(key.mode) * 0x9e3779b97f4a7c15);
+  }
+};
+
+struct FileHandleCache::Impl {
+  std::unordered_map<FileHandleKey, std::unique_ptr<FileHandleEntry>, FileHandleKeyHash> entries;
+  std::list<FileHandleEntry *> idle;                  // not leased, most recently used first
+  std::vector<std::unique_ptr<FileHandleEntry>> stale; // invalidated while leased
+
+  auto acquire(FileHandleCache &cache, const std::filesystem::path &path, FileReadMode mode, HANDLE iocp_handle)
+    -> FileHandleEntry *;
+  auto release(FileHandleCache &cache, FileHandleEntry *entry) -> void;
+  auto drop(FileHandleCache &cache, decltype(entries)::iterator it) -> void;
+  auto evict(FileHandleCache &cache) -> void;
+};
+
+struct FileMapping {
+  HANDLE file_handle = nullptr;
+  HANDLE mapping_handle = nullptr;
+  void *view = nullptr;
+
+  inline FileMapping() = default;
+  inline FileMapping(const FileMapping &other) = delete;
+
+  inline ~FileMapping() {
+    if (view != nullptr) {
+      ::UnmapViewOfFile(view);
+    }
+    if (mapping_handle != nullptr) {
+      ::CloseHandle(mapping_handle);
+    }
+    if (file_handle != nullptr and file_handle != INVALID_HANDLE_VALUE) {
+      ::CloseHandle(file_handle);
+    }
+  }
+};
+
+struct MappedFile::Impl {
+  std::shared_ptr<FileMapping> mapping;
+  std::span<const char> data;
 };
 
 struct OverlappedFileReadBuf : OVERLAPPED {
@@ -46,3 +121,40 @@ struct FileReadAll::Impl {
 };
 
 } // namespace cotask
+
+namespace cotask {
+
+struct FileWriter::Impl {
+  HANDLE file_handle = nullptr;
+};
+
+struct OverlappedFileWriteBuf : OVERLAPPED {
+  const FileIoType type = FileIoType::WriteBuf;
+  FileWriteBuf *awaitable;
+
+  inline explicit OverlappedFileWriteBuf(FileWriteBuf *write_buf) : OVERLAPPED{}, awaitable{write_buf} {}
+};
+
+struct FileWriteBuf::Impl {
+  OverlappedFileWriteBuf ovex;
+
+  inline explicit Impl(FileWriteBuf *awaitable) : ovex{awaitable} {}
+};
+
+struct OverlappedFileFlush : OVERLAPPED {
+  const FileIoType type = FileIoType::Flush;
+  FileFlush *awaitable;
+  HANDLE iocp_handle = nullptr;
+  PTP_WORK work = nullptr;
+  DWORD err_code = 0;
+
+  inline explicit OverlappedFileFlush(FileFlush *flush) : OVERLAPPED{}, awaitable{flush} {}
+};
+
+struct FileFlush::Impl {
+  OverlappedFileFlush ovex;
+
+  inline explicit Impl(FileFlush *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
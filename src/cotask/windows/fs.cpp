@@ -0,0 +1,244 @@
+#include "cotask.hpp"
+#include "fs.hpp"
+
+#include <cotask/impl.hpp>
+#include <cotask/utils.hpp>
+
+#include <bit>
+#include <iostream>
+
+namespace cotask {
+
+static auto to_u64(DWORD high, DWORD low) -> std::uint64_t {
+  return (static_cast<std::uint64_t>(high) << 32) | low;
+}
+
+} // namespace cotask
+
+// Stat
+namespace cotask {
+
+FileStatBatch::FileStatBatch(TaskScheduler &ts, std::span<const std::filesystem::path> paths, std::size_t batch_size)
+    : ts{ts}, paths{paths}, stats(paths.size()) {
+  IMPL_CONSTRUCT();
+
+  if (paths.empty()) {
+    finished = true;
+    success = true;
+    return;
+  }
+  if (batch_size == 0) {
+    batch_size = 1;
+  }
+
+  // split paths into batches, each batch is stat-ed by one worker
+  for (auto i = std::size_t{0}; i < paths.size(); i += batch_size) {
+    const auto count = paths.size() - i < batch_size ? paths.size() - i : batch_size;
+
+    auto ovex = std::make_unique<OverlappedFsStat>(this);
+    ovex->iocp_handle = ts.impl->iocp_handle;
+    ovex->paths = paths.subspan(i, count);
+    ovex->stats = std::span{stats}.subspan(i, count);
+    ovex->work = ::CreateThreadpoolWork(
+      [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+        auto ovex = static_cast<OverlappedFsStat *>(context);
+
+        for (auto j = std::size_t{0}; j < ovex->paths.size(); ++j) {
+          auto &stat = ovex->stats[j];
+          stat.path = ovex->paths[j];
+
+          auto data = WIN32_FILE_ATTRIBUTE_DATA{};
+          if (not ::GetFileAttributesExW(stat.path.c_str(), GetFileExInfoStandard, &data)) {
+            continue;
+          }
+          stat.success = true;
+          stat.is_directory = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+          stat.size = to_u64(data.nFileSizeHigh, data.nFileSizeLow);
+          stat.last_write_time = to_u64(data.ftLastWriteTime.dwHighDateTime, data.ftLastWriteTime.dwLowDateTime);
+        }
+
+        ::PostQueuedCompletionStatus(ovex->iocp_handle, 0, std::bit_cast<ULONG_PTR>(ovex->awaitable), ovex);
+      },
+      ovex.get(), nullptr);
+
+    if (ovex->work == nullptr) {
+      const auto err_code = ::GetLastError();
+      std::cerr << utils::with_location(std::format("CreateThreadpoolWork failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      failed = true;
+      break;
+    }
+
+    ::SubmitThreadpoolWork(ovex->work);
+    impl->works.push_back(std::move(ovex));
+    in_flight += 1;
+  }
+
+  // submitted batches are waited for even after a failure, their completions point at this awaitable
+  success = in_flight != 0;
+}
+
+FileStatBatch::~FileStatBatch() {
+  for (auto &ovex : impl->works) {
+    ::WaitForThreadpoolWorkCallbacks(ovex->work, FALSE);
+    ::CloseThreadpoolWork(ovex->work);
+  }
+  std::destroy_at(impl);
+}
+
+auto FileStatBatch::io_stat() -> void {
+  in_flight -= 1;
+
+  // check finished
+  if (in_flight == 0) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = not failed;
+  }
+}
+
+} // namespace cotask
+
+// ListDir
+namespace cotask {
+
+DirectoryWalker::DirectoryWalker(TaskScheduler &ts, const std::filesystem::path &root, std::size_t max_in_flight)
+    : ts{ts}, max_in_flight{max_in_flight == 0 ? 1 : max_in_flight} {
+  IMPL_CONSTRUCT();
+
+  pending_dirs.push_back(root);
+  success = io_request();
+  if (not impl->works.empty()) {
+    impl->works.front()->is_root = true;
+  }
+}
+
+DirectoryWalker::~DirectoryWalker() {
+  // posted completions point at the walker and its works
+  assert(in_flight == 0 and "DirectoryWalker must be closed (co_await walker.close()) when stopped early");
+  for (auto &ovex : impl->works) {
+    ::WaitForThreadpoolWorkCallbacks(ovex->work, FALSE);
+    ::CloseThreadpoolWork(ovex->work);
+  }
+  std::destroy_at(impl);
+}
+
+auto DirectoryWalker::io_request() -> bool {
+  while (in_flight < max_in_flight and not pending_dirs.empty()) {
+    auto ovex = std::make_unique<OverlappedFsListDir>(this);
+    ovex->iocp_handle = ts.impl->iocp_handle;
+    ovex->dir = std::move(pending_dirs.front());
+    pending_dirs.pop_front();
+
+    ovex->work = ::CreateThreadpoolWork(
+      [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+        auto ovex = static_cast<OverlappedFsListDir *>(context);
+
+        // list directory (FindExInfoBasic returns size and time with each entry, no extra stat needed)
+        auto find_data = WIN32_FIND_DATAW{};
+        const auto pattern = ovex->dir / L"*";
+        auto find_handle = ::FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &find_data, FindExSearchNameMatch,
+                                              nullptr, FIND_FIRST_EX_LARGE_FETCH);
+        if (find_handle == INVALID_HANDLE_VALUE) {
+          ovex->err_code = ::GetLastError();
+        } else {
+          do {
+            const auto name = std::wstring_view{find_data.cFileName};
+            if (name == L"." or name == L"..") {
+              continue;
+            }
+            ovex->entries.push_back({
+              .path = ovex->dir / name,
+              .success = true,
+              .is_directory = (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 and
+                              (find_data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0,
+              .size = to_u64(find_data.nFileSizeHigh, find_data.nFileSizeLow),
+              .last_write_time =
+                to_u64(find_data.ftLastWriteTime.dwHighDateTime, find_data.ftLastWriteTime.dwLowDateTime),
+            });
+          } while (::FindNextFileW(find_handle, &find_data));
+
+          const auto err_code = ::GetLastError();
+          if (err_code != ERROR_NO_MORE_FILES) {
+            ovex->err_code = err_code;
+          }
+          ::FindClose(find_handle);
+        }
+
+        ::PostQueuedCompletionStatus(ovex->iocp_handle, 0, std::bit_cast<ULONG_PTR>(ovex->awaitable), ovex);
+      },
+      ovex.get(), nullptr);
+
+    if (ovex->work == nullptr) {
+      const auto err_code = ::GetLastError();
+      std::cerr << utils::with_location(std::format("CreateThreadpoolWork failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return false;
+    }
+
+    ::SubmitThreadpoolWork(ovex->work);
+    impl->works.push_back(std::move(ovex));
+    in_flight += 1;
+  }
+
+  return true;
+}
+
+auto DirectoryWalker::io_listed(OverlappedFsListDir *ovex) -> void {
+  in_flight -= 1;
+
+  if (ovex->err_code != 0) {
+    auto path_str = std::filesystem::absolute(ovex->dir).string();
+    std::cerr << utils::with_location(std::format("FindFirstFileExW failed for \"{}\": {}", path_str, ovex->err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)ovex->err_code));
+    // an unreadable sub directory is skipped, a missing or unreadable root fails the walk
+    if (ovex->is_root) {
+      success = false;
+    }
+  }
+
+  // queue sub directories
+  if (not closing) {
+    for (const auto &entry : ovex->entries) {
+      if (entry.is_directory) {
+        pending_dirs.push_back(entry.path);
+      }
+    }
+    if (not ovex->entries.empty()) {
+      ready_batches.push_back(std::move(ovex->entries));
+    }
+  }
+
+  // release work
+  ::CloseThreadpoolWork(ovex->work);
+  for (auto &work : impl->works) {
+    if (work.get() == ovex) {
+      std::swap(work, impl->works.back());
+      impl->works.pop_back();
+      break;
+    }
+  }
+
+  if (closing) {
+    if (in_flight == 0 and close_is_waiting != nullptr) {
+      *close_is_waiting = false;
+    }
+    return;
+  }
+
+  // list more directories
+  if (success and not io_request()) {
+    success = false;
+  }
+
+  // check ready
+  if (not ready_batches.empty() or done() or not success) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+  }
+}
+
+} // namespace cotask
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cotask/fs.hpp>
+
+#include <memory>
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+namespace cotask {
+
+struct OverlappedFs : public OVERLAPPED {
+  const FsIoType type;
+};
+
+} // namespace cotask
+
+// ListDir
+namespace cotask {
+
+struct OverlappedFsListDir : public OVERLAPPED {
+  const FsIoType type = FsIoType::ListDir;
+  DirectoryWalker *awaitable;
+  HANDLE iocp_handle = nullptr;
+  PTP_WORK work = nullptr;
+
+  std::filesystem::path dir;
+  std::vector<FileStatInfo> entries;
+  DWORD err_code = 0;
+  bool is_root = false;
+
+  inline explicit OverlappedFsListDir(DirectoryWalker *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct DirectoryWalker::Impl {
+  std::vector<std::unique_ptr<OverlappedFsListDir>> works;
+};
+
+} // namespace cotask
+
+// Stat
+namespace cotask {
+
+struct OverlappedFsStat : public OVERLAPPED {
+  const FsIoType type = FsIoType::Stat;
+  FileStatBatch *awaitable;
+  HANDLE iocp_handle = nullptr;
+  PTP_WORK work = nullptr;
+
+  std::span<const std::filesystem::path> paths;
+  std::span<FileStatInfo> stats;
+
+  inline explicit OverlappedFsStat(FileStatBatch *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct FileStatBatch::Impl {
+  std::vector<std::unique_ptr<OverlappedFsStat>> works;
+};
+
+} // namespace cotask
@@ -1,10 +1,13 @@
 #include "cotask.hpp"
+#include "dns.hpp"
+#include "file.hpp"
 #include "tcp.hpp"
 #include "timer.hpp"
 
 #include <cotask/impl.hpp>
 #include <cotask/utils.hpp>
 
+#include <cstring>
 #include <iostream>
 
 #include <ws2tcpip.h>
@@ -12,11 +15,11 @@
 // TcpSocket
 namespace cotask {
 
-TcpSocket::TcpSocket(TaskScheduler &ts) : ts{ts} {
+TcpSocket::TcpSocket(TaskScheduler &ts, SocketOptions options) : ts{ts}, options{options} {
   IMPL_CONSTRUCT();
 }
 
-TcpSocket::TcpSocket(const TcpSocket &other) : ts{other.ts} {
+TcpSocket::TcpSocket(const TcpSocket &other) : ts{other.ts}, options{other.options} {
   IMPL_COPY(*other.impl);
 }
 
@@ -30,11 +33,67 @@ auto TcpSocket::operator=(const TcpSocket &other) -> TcpSocket & {
   }
   *this->impl = *other.impl;
   this->ts = other.ts;
+  this->options = other.options;
   return *this;
 }
 
 } // namespace cotask
 
+// Options
+namespace cotask {
+
+static auto set_socket_option(SOCKET socket, int level, int name, int value, std::string_view name_str) -> bool {
+  if (::setsockopt(socket, level, name, (const char *)&value, sizeof(value)) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("setsockopt {} failed: {}", name_str, err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+  return true;
+}
+
+static auto apply_socket_options(SOCKET socket, const SocketOptions &options) -> bool {
+  auto success = true;
+  if (options.no_delay) {
+    success &= set_socket_option(socket, IPPROTO_TCP, TCP_NODELAY, *options.no_delay, "TCP_NODELAY");
+  }
+  if (options.fast_open) {
+    success &= set_socket_option(socket, IPPROTO_TCP, TCP_FASTOPEN, *options.fast_open, "TCP_FASTOPEN");
+  }
+  if (options.keep_alive) {
+    success &= set_socket_option(socket, SOL_SOCKET, SO_KEEPALIVE, *options.keep_alive, "SO_KEEPALIVE");
+  }
+  if (options.send_buffer_size) {
+    success &= set_socket_option(socket, SOL_SOCKET, SO_SNDBUF, *options.send_buffer_size, "SO_SNDBUF");
+  }
+  if (options.recv_buffer_size) {
+    success &= set_socket_option(socket, SOL_SOCKET, SO_RCVBUF, *options.recv_buffer_size, "SO_RCVBUF");
+  }
+  if (options.quick_ack) {
+    // ack every segment (1) or the default delayed ack frequency (2)
+    auto frequency = DWORD{*options.quick_ack ? 1u : 2u};
+    auto bytes = DWORD{};
+    if (::WSAIoctl(socket, SIO_TCP_SET_ACK_FREQUENCY, &frequency, sizeof(frequency), nullptr, 0, &bytes, nullptr,
+                   nullptr) != 0) {
+      const auto err_code = ::WSAGetLastError();
+      std::cerr << utils::with_location(std::format("SIO_TCP_SET_ACK_FREQUENCY failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      success = false;
+    }
+  }
+  return success;
+}
+
+auto TcpSocket::set_options(const SocketOptions &options) -> bool {
+  this->options = options;
+  if (impl->socket == INVALID_SOCKET) {
+    return true;
+  }
+  return apply_socket_options(impl->socket, options);
+}
+
+} // namespace cotask
+
 // Listen
 namespace cotask {
 
@@ -68,6 +127,9 @@ auto TcpSocket::listen(std::uint16_t port) -> bool {
     return false;
   }
 
+  // buffer sizes and fast open must be set before listen, accepted sockets inherit the rest in `TcpAccept`
+  apply_socket_options(impl->socket, options);
+
   // setup IOCP
   if (not ::CreateIoCompletionPort(impl->get_handle(), ts.impl->iocp_handle, (ULONG_PTR)this, 0)) {
     const auto err_code = ::GetLastError();
@@ -147,6 +209,7 @@ auto TcpAccept::io_received(std::uint32_t) -> void {
   if (is_waiting != nullptr) {
     *is_waiting = false;
   }
+  accept_socket->set_options(tcp_socket.options);
   finished = true;
   success = true;
 }
@@ -166,6 +229,160 @@ auto TcpAccept::io_failed(std::uint32_t err_code) -> void {
 
 } // namespace cotask
 
+// AcceptStream
+namespace cotask {
+
+AcceptStream::AcceptStream(TcpSocket *sock, AcceptStreamOptions options)
+    : tcp_socket{*sock}, ts{sock->ts}, options{options} {
+  IMPL_CONSTRUCT();
+
+  if (this->options.depth == 0) {
+    this->options.depth = 1;
+  }
+  if (this->options.max_batch == 0) {
+    this->options.max_batch = 1;
+  }
+
+  impl->slots.reserve(this->options.depth);
+  for (auto i = std::size_t{0}; i < this->options.depth; ++i) {
+    impl->slots.push_back(std::make_unique<OverlappedTcpAcceptStream>(this, i));
+    if (not arm(i)) {
+      break;
+    }
+  }
+
+  success = armed != 0;
+}
+
+AcceptStream::~AcceptStream() {
+  assert(armed == 0 and "AcceptStream must be closed (co_await stream.close()) before it is destroyed");
+  std::destroy_at(impl);
+}
+
+auto AcceptStream::close() -> AcceptStreamClose {
+  if (not closing) {
+    closing = true;
+    for (auto &slot : impl->slots) {
+      if (slot->socket != INVALID_SOCKET) {
+        ::CancelIoEx(tcp_socket.impl->get_handle(), slot.get());
+      }
+    }
+  }
+  wake();
+  return {*this};
+}
+
+auto AcceptStream::arm(std::size_t slot) -> bool {
+  auto &ovex = *impl->slots[slot];
+  static_cast<OVERLAPPED &>(ovex) = OVERLAPPED{};
+
+  // create socket
+  ovex.socket = ::WSASocketW(AF_INET, SOCK_STREAM, IPPROTO_IP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+  if (ovex.socket == INVALID_SOCKET) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("WSASocketW failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  // accept
+  auto accept_success = ::AcceptEx(tcp_socket.impl->socket, ovex.socket, ovex.addr_buf, 0, sizeof(ovex.addr_buf) / 2,
+                                   sizeof(ovex.addr_buf) / 2, &ovex.bytes_received, &ovex);
+  if (not accept_success) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("AcceptEx failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      ::closesocket(ovex.socket);
+      ovex.socket = INVALID_SOCKET;
+      return false;
+    }
+  }
+
+  armed += 1;
+  return true;
+}
+
+auto AcceptStream::wake() -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  if (armed == 0 and close_is_waiting != nullptr) {
+    *close_is_waiting = false;
+  }
+}
+
+auto AcceptStream::io_accepted(std::size_t slot) -> void {
+  auto &ovex = *impl->slots[slot];
+  armed -= 1;
+  if (armed == 0 and options.depth > 1 and not closing) {
+    // the completions outran the re-arms, nothing is posted for the next connection
+    stats.backlog_full += 1;
+  }
+
+  const auto conn_socket = std::exchange(ovex.socket, INVALID_SOCKET);
+  if (closing) {
+    ::closesocket(conn_socket);
+    wake();
+    return;
+  }
+
+  // inherit the listening socket properties (getpeername, shutdown)
+  ::setsockopt(conn_socket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT, (const char *)&tcp_socket.impl->socket,
+               sizeof(tcp_socket.impl->socket));
+
+  // setup iocp, the accepted socket is the completion key so its address must not change
+  auto accept_socket = std::make_shared<TcpSocket>(ts);
+  accept_socket->impl->socket = conn_socket;
+  accept_socket->set_options(tcp_socket.options);
+  if (not ::CreateIoCompletionPort(accept_socket->impl->get_handle(), ts.impl->iocp_handle,
+                                   (ULONG_PTR)accept_socket.get(), 0)) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("CreateIoCompletionPort failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    ::closesocket(conn_socket);
+    stats.failed += 1;
+  } else {
+    ready.push_back(std::move(accept_socket));
+    stats.accepted += 1;
+  }
+
+  // re-arm right away so the next connection does not wait for the consumer
+  if (not arm(slot)) {
+    stats.backlog_full += 1;
+    if (armed == 0) {
+      success = false;
+    }
+  }
+  wake();
+}
+
+auto AcceptStream::io_failed(std::size_t slot, std::uint32_t err_code) -> void {
+  auto &ovex = *impl->slots[slot];
+  armed -= 1;
+  ::closesocket(std::exchange(ovex.socket, INVALID_SOCKET));
+
+  if (closing) {
+    wake();
+    return;
+  }
+
+  stats.failed += 1;
+  std::cerr << utils::with_location(std::format("AcceptStream compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+
+  // a reset while in the accept queue only loses that connection
+  if (not arm(slot)) {
+    stats.backlog_full += 1;
+    if (armed == 0) {
+      success = false;
+    }
+  }
+  wake();
+}
+
+} // namespace cotask
+
 // Connect
 namespace cotask {
 
@@ -181,6 +398,8 @@ TcpConnect::TcpConnect(TcpSocket *sock, std::string_view ip, std::string_view po
     return;
   }
 
+  apply_socket_options(tcp_socket.impl->socket, tcp_socket.options);
+
   // get ConnectEx function pointer
   if (tcp_socket.impl->fnConnectEx == nullptr) {
     auto guid = GUID WSAID_CONNECTEX;
@@ -219,39 +438,57 @@ TcpConnect::TcpConnect(TcpSocket *sock, std::string_view ip, std::string_view po
     return;
   }
 
-  // resolve the server address and port
-  auto connect_addr_list = PADDRINFOA{};
-  auto addr_hints = addrinfo{};
-  addr_hints.ai_family = AF_INET;
-  addr_hints.ai_socktype = SOCK_STREAM;
-  addr_hints.ai_protocol = IPPROTO_TCP;
-
-  auto getaddr_result = ::getaddrinfo(ip.data(), port.data(), &addr_hints, &connect_addr_list);
-  if (getaddr_result != 0) {
-    std::cerr << utils::with_location(std::format("getaddrinfo failed: {}\n", getaddr_result))
-              << std::format("err msg: {}\n", ::gai_strerrorA(getaddr_result));
+  // resolve the server address and port, connects once resolved
+  impl->resolving = true;
+  auto on_resolved = [this](const DnsEntry &entry) {
+    impl->resolving = false;
+    if (finished) {
+      return;
+    }
+    if (entry.addrs.empty() or not io_connect(&entry.addrs.front())) {
+      ::closesocket(tcp_socket.impl->socket);
+      if (is_waiting != nullptr) {
+        *is_waiting = false;
+      }
+      finished = true;
+      success = false;
+    }
+  };
+  if (not ts.dns.impl->resolve(ts.dns, ts.impl->iocp_handle, ip, port, this, std::move(on_resolved))) {
+    impl->resolving = false;
     ::closesocket(tcp_socket.impl->socket);
     return;
   }
 
+  // a cached negative answer fails right away
+  if (finished) {
+    return;
+  }
+
+  success = true;
+}
+
+auto TcpConnect::io_connect(const void *addr) -> bool {
   // connect
-  auto connect_success = tcp_socket.impl->fnConnectEx(tcp_socket.impl->socket, connect_addr_list->ai_addr,
-                                                      sizeof(SOCKADDR), nullptr, 0, nullptr, &impl->ovex);
-  ::freeaddrinfo(connect_addr_list);
+  auto connect_success = tcp_socket.impl->fnConnectEx(tcp_socket.impl->socket, static_cast<const SOCKADDR *>(addr),
+                                                      sizeof(SOCKADDR_IN), nullptr, 0, nullptr, &impl->ovex);
   if (not connect_success) {
     const auto err_code = ::WSAGetLastError();
     if (err_code != WSA_IO_PENDING) {
       std::cerr << utils::with_location(std::format("ConnectEx failed: {}", err_code))
                 << std::format("err msg: {}\n", std::system_category().message((int)err_code));
-      ::closesocket(tcp_socket.impl->socket);
-      return;
+      return false;
     }
   }
 
-  success = true;
+  return true;
 }
 
 TcpConnect::~TcpConnect() {
+  // the lookup may outlive the awaitable, its callback must not reach it
+  if (impl->resolving) {
+    ts.dns.impl->cancel(this);
+  }
   std::destroy_at(impl);
 }
 
@@ -281,7 +518,41 @@ auto TcpConnect::io_failed(std::uint32_t err_code) -> void {
 // Close
 namespace cotask {
 
+auto TcpSocket::is_alive() const -> bool {
+  if (impl->socket == INVALID_SOCKET) {
+    return false;
+  }
+
+  // an idle connection becomes readable on fin / rst
+  auto poll_fd = WSAPOLLFD{
+    .fd = impl->socket,
+    .events = POLLRDNORM,
+    .revents = 0,
+  };
+  const auto poll_result = ::WSAPoll(&poll_fd, 1, 0);
+  if (poll_result == SOCKET_ERROR) {
+    return false;
+  }
+  return poll_result == 0;
+}
+
+auto TcpSocket::shutdown_send() -> bool {
+  if (::shutdown(impl->socket, SD_SEND) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("shutdown failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+  return true;
+}
+
 auto TcpSocket::close() -> bool {
+  // everything the connection allocated goes at once (after the coroutine frames in the arena are gone),
+  // coroutines started for the socket afterwards allocate from the heap
+  if (arena != nullptr) {
+    std::exchange(arena, nullptr)->release();
+  }
+
   if (::shutdown(impl->socket, SD_BOTH) != 0) {
     const auto err_code = ::WSAGetLastError();
     if (err_code != WSAENOTCONN) {
@@ -321,8 +592,8 @@ auto TcpSocket::close() -> bool {
 // Recv
 namespace cotask {
 
-TcpRecv::TcpRecv(TcpSocket *sock, std::span<char> buf, std::uint64_t timeout)
-    : tcp_socket{*sock}, ts{sock->ts}, buf{buf}, timer{timeout} {
+TcpRecv::TcpRecv(TcpSocket *sock, std::span<char> buf, std::uint64_t timeout, Checksum checksum)
+    : tcp_socket{*sock}, ts{sock->ts}, buf{buf}, timer{timeout}, checksum{checksum} {
   IMPL_CONSTRUCT(this);
 
   auto wsa_buf = WSABUF{
@@ -393,6 +664,10 @@ auto TcpRecv::io_received(std::uint32_t bytes_received) -> void {
   this->bytes_received = bytes_received;
   buf = {buf.data(), bytes_received};
   timer.close();
+
+  if (checksum == Checksum::Crc32c) {
+    crc.update(buf);
+  }
 }
 
 auto TcpRecv::io_failed(std::uint32_t err_code) -> void {
@@ -412,8 +687,8 @@ auto TcpRecv::io_failed(std::uint32_t err_code) -> void {
 // RecvAll
 namespace cotask {
 
-TcpRecvAll::TcpRecvAll(TcpSocket *sock, std::span<char> buf, std::uint64_t timeout)
-    : tcp_socket{*sock}, ts{sock->ts}, buf{buf}, timer{timeout} {
+TcpRecvAll::TcpRecvAll(TcpSocket *sock, std::span<char> buf, std::uint64_t timeout, Checksum checksum)
+    : tcp_socket{*sock}, ts{sock->ts}, buf{buf}, timer{timeout}, checksum{checksum} {
   IMPL_CONSTRUCT(this);
 
   if (not io_request()) {
@@ -485,6 +760,9 @@ auto TcpRecvAll::io_request() -> bool {
 }
 
 auto TcpRecvAll::io_received(std::uint32_t bytes_received) -> void {
+  if (checksum == Checksum::Crc32c) {
+    crc.update({buf.data() + total_bytes_received, bytes_received});
+  }
   total_bytes_received += bytes_received;
 
   // check finished
@@ -531,86 +809,77 @@ auto TcpRecvAll::io_failed(std::uint32_t err_code) -> void {
 
 } // namespace cotask
 
-// Send
+// RecvV
 namespace cotask {
 
-TcpSend::TcpSend(TcpSocket *sock, std::span<const char> buf) : tcp_socket{*sock}, ts{sock->ts}, buf{buf} {
+TcpRecvV::TcpRecvV(TcpSocket *sock, std::span<const std::span<char>> bufs, std::uint64_t timeout, bool all)
+    : tcp_socket{*sock}, ts{sock->ts}, all{all}, bufs{bufs}, timer{timeout} {
   IMPL_CONSTRUCT(this);
 
-  auto wsa_buf = WSABUF{
-    .len = static_cast<ULONG>(buf.size()),
-    .buf = const_cast<char *>(buf.data()),
-  };
-
-  // send
-  auto send_result = ::WSASend(tcp_socket.impl->socket, &wsa_buf, 1ul, (PULONG)&bytes_sent, 0, &impl->ovex, nullptr);
-  if (send_result != 0) {
-    const auto err_code = ::WSAGetLastError();
-    if (err_code != WSA_IO_PENDING) {
-      std::cerr << utils::with_location(std::format("WSASend failed: {}", err_code))
-                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
-      return;
-    }
+  for (const auto buf : bufs) {
+    total_size += buf.size();
   }
-
-  success = true;
-}
-
-TcpSend::~TcpSend() {
-  std::destroy_at(impl);
-}
-
-auto TcpSend::io_sent(std::uint32_t bytes_sent) -> void {
-  if (is_waiting != nullptr) {
-    *is_waiting = false;
+  if (total_size == 0) {
+    finished = true;
+    success = true;
+    return;
   }
-  finished = true;
-  success = true;
-  this->bytes_sent = bytes_sent;
-}
 
-auto TcpSend::io_failed(std::uint32_t err_code) -> void {
-  if (is_waiting != nullptr) {
-    *is_waiting = false;
+  if (not io_request()) {
+    return;
   }
-  finished = true;
-  success = false;
 
-  std::cerr << utils::with_location(std::format("TcpSend compeletion failed: {}", err_code))
-            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
-}
+  if (timeout > 0) {
+    // create timer
+    timer.impl->timer = ::CreateThreadpoolTimer(
+      [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) {
+        auto awaitable = static_cast<TcpRecvV *>(context);
 
-} // namespace cotask
+        awaitable->timer.fn_on_ended = [=]() {
+          if (::CancelIoEx(std::bit_cast<HANDLE>(awaitable->tcp_socket.impl->socket), &awaitable->impl->ovex) == 0) {
+            const auto err_code = ::GetLastError();
+            std::cerr << utils::with_location(std::format("CancelIoEx failed: {}", err_code))
+                      << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+          }
 
-// SendAll
-namespace cotask {
+          awaitable->finished = false;
+          awaitable->success = false;
+        };
 
-TcpSendAll::TcpSendAll(TcpSocket *sock, std::span<const char> buf) : tcp_socket{*sock}, ts{sock->ts}, buf{buf} {
-  IMPL_CONSTRUCT(this);
+        auto &ts = awaitable->ts;
+        ::PostQueuedCompletionStatus(ts.impl->iocp_handle, 0, std::bit_cast<ULONG_PTR>(&awaitable->timer), nullptr);
+      },
+      this, nullptr);
 
-  if (not io_request()) {
-    return;
+    if (timer.impl->timer == nullptr) {
+      const auto err_code = ::GetLastError();
+      std::cerr << utils::with_location(std::format("CreateThreadpoolTimer failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return;
+    }
+
+    timer.start();
   }
 
   success = true;
 }
 
-TcpSendAll::~TcpSendAll() {
+TcpRecvV::~TcpRecvV() {
   std::destroy_at(impl);
 }
 
-auto TcpSendAll::io_request() -> bool {
-  auto wsa_buf = WSABUF{
-    .len = static_cast<ULONG>(buf.size()),
-    .buf = const_cast<char *>(buf.data()),
-  };
+auto TcpRecvV::io_request() -> bool {
+  impl->wsa_bufs.assign(bufs, total_bytes_received);
+  static_cast<OVERLAPPED &>(impl->ovex) = OVERLAPPED{};
+  auto flags = ULONG{};
 
-  // send
-  auto send_result = ::WSASend(tcp_socket.impl->socket, &wsa_buf, 1ul, (PULONG)&bytes_sent, 0, &impl->ovex, nullptr);
-  if (send_result != 0) {
+  // recv
+  auto recv_result = ::WSARecv(tcp_socket.impl->socket, impl->wsa_bufs.bufs, impl->wsa_bufs.count, nullptr, &flags,
+                               &impl->ovex, nullptr);
+  if (recv_result != 0) {
     const auto err_code = ::WSAGetLastError();
     if (err_code != WSA_IO_PENDING) {
-      std::cerr << utils::with_location(std::format("WSASend failed: {}", err_code))
+      std::cerr << utils::with_location(std::format("WSARecv failed: {}", err_code))
                 << std::format("err msg: {}\n", std::system_category().message((int)err_code));
       return false;
     }
@@ -619,37 +888,753 @@ auto TcpSendAll::io_request() -> bool {
   return true;
 }
 
-auto TcpSendAll::io_sent(std::uint32_t bytes_sent) -> void {
-  total_bytes_sent += bytes_sent;
+auto TcpRecvV::io_received(std::uint32_t bytes_received) -> void {
+  total_bytes_received += bytes_received;
 
   // check finished
-  if (total_bytes_sent == buf.size()) {
+  if (not all or total_bytes_received == total_size or bytes_received == 0) {
     if (is_waiting != nullptr) {
       *is_waiting = false;
     }
     finished = true;
-    success = true;
+    // zero bytes: closed
+    success = bytes_received != 0;
+    timer.close();
     return;
   }
 
-  // send more bytes
+  // recv more bytes
   if (not io_request()) {
     if (is_waiting != nullptr) {
       *is_waiting = false;
     }
     finished = true;
     success = false;
+    timer.close();
   }
 }
 
-auto TcpSendAll::io_failed(std::uint32_t err_code) -> void {
+auto TcpRecvV::io_failed(std::uint32_t err_code) -> void {
   if (is_waiting != nullptr) {
     *is_waiting = false;
   }
   finished = true;
   success = false;
+  timer.close();
 
-  std::cerr << utils::with_location(std::format("TcpSendAll compeletion failed: {}", err_code))
+  std::cerr << utils::with_location(std::format("TcpRecvV compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// RecvPooled
+namespace cotask {
+
+TcpRecvPooled::TcpRecvPooled(TcpSocket *sock, std::size_t max_size, std::uint64_t timeout)
+    : tcp_socket{*sock}, ts{sock->ts}, max_size{max_size}, timer{timeout} {
+  IMPL_CONSTRUCT(this);
+
+  if (not io_request()) {
+    return;
+  }
+
+  if (timeout > 0) {
+    // create timer
+    timer.impl->timer = ::CreateThreadpoolTimer(
+      [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) {
+        auto awaitable = static_cast<TcpRecvPooled *>(context);
+
+        awaitable->timer.fn_on_ended = [=]() {
+          if (::CancelIoEx(std::bit_cast<HANDLE>(awaitable->tcp_socket.impl->socket), &awaitable->impl->ovex) == 0) {
+            const auto err_code = ::GetLastError();
+            std::cerr << utils::with_location(std::format("CancelIoEx failed: {}", err_code))
+                      << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+          }
+
+          awaitable->finished = false;
+          awaitable->success = false;
+        };
+
+        auto &ts = awaitable->ts;
+        ::PostQueuedCompletionStatus(ts.impl->iocp_handle, 0, std::bit_cast<ULONG_PTR>(&awaitable->timer), nullptr);
+      },
+      this, nullptr);
+
+    if (timer.impl->timer == nullptr) {
+      const auto err_code = ::GetLastError();
+      std::cerr << utils::with_location(std::format("CreateThreadpoolTimer failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return;
+    }
+
+    timer.start();
+  }
+
+  success = true;
+}
+
+TcpRecvPooled::~TcpRecvPooled() {
+  std::destroy_at(impl);
+}
+
+auto TcpRecvPooled::io_request() -> bool {
+  // zero byte recv: completes when data arrives without pinning a buffer while idle
+  auto wsa_buf = WSABUF{
+    .len = 0,
+    .buf = nullptr,
+  };
+  auto flags = ULONG{};
+
+  auto recv_result = ::WSARecv(tcp_socket.impl->socket, &wsa_buf, 1ul, nullptr, &flags, &impl->ovex, nullptr);
+  if (recv_result != 0) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("WSARecv failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+auto TcpRecvPooled::io_received(std::uint32_t) -> void {
+  // data is ready (or the peer closed), FIONREAD tells how much can be read without blocking
+  auto bytes_available = ULONG{};
+  if (::ioctlsocket(tcp_socket.impl->socket, FIONREAD, &bytes_available) != 0) {
+    io_failed(static_cast<std::uint32_t>(::WSAGetLastError()));
+    return;
+  }
+
+  auto bytes_received = 0;
+  if (bytes_available != 0) {
+    const auto size = bytes_available < max_size ? static_cast<std::size_t>(bytes_available) : max_size;
+    lease = ts.aligned_buffers.acquire(size);
+    bytes_received = ::recv(tcp_socket.impl->socket, lease.buf.data(), static_cast<int>(size), 0);
+    if (bytes_received == SOCKET_ERROR) {
+      lease.release();
+      io_failed(static_cast<std::uint32_t>(::WSAGetLastError()));
+      return;
+    }
+  }
+
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = bytes_received != 0;
+  buf = {lease.buf.data(), static_cast<std::size_t>(bytes_received)};
+  if (not success) {
+    // closed
+    lease.release();
+  }
+  timer.close();
+}
+
+auto TcpRecvPooled::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+  timer.close();
+
+  std::cerr << utils::with_location(std::format("TcpRecvPooled compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// RecvStream
+namespace cotask {
+
+TcpRecvStream::TcpRecvStream(TcpSocket *sock, TcpRecvStreamOptions options)
+    : tcp_socket{*sock}, ts{sock->ts}, options{options} {
+  IMPL_CONSTRUCT(this);
+
+  if (this->options.max_queued == 0) {
+    this->options.max_queued = 1;
+  }
+
+  success = arm();
+}
+
+TcpRecvStream::~TcpRecvStream() {
+  assert(not armed and "TcpRecvStream must be closed (co_await stream.close()) before it is destroyed");
+  std::destroy_at(impl);
+}
+
+auto TcpRecvStream::close() -> TcpRecvStreamClose {
+  if (not closing) {
+    closing = true;
+    if (armed) {
+      ::CancelIoEx(tcp_socket.impl->get_handle(), &impl->ovex);
+    }
+  }
+  wake();
+  return {*this};
+}
+
+auto TcpRecvStream::arm() -> bool {
+  if (lease.empty()) {
+    lease = ts.aligned_buffers.acquire(options.chunk_size);
+  }
+  static_cast<OVERLAPPED &>(impl->ovex) = OVERLAPPED{};
+
+  auto wsa_buf = WSABUF{
+    .len = static_cast<ULONG>(options.chunk_size),
+    .buf = lease.buf.data(),
+  };
+  auto flags = ULONG{};
+
+  // recv
+  auto recv_result = ::WSARecv(tcp_socket.impl->socket, &wsa_buf, 1ul, nullptr, &flags, &impl->ovex, nullptr);
+  if (recv_result != 0) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("WSARecv failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return false;
+    }
+  }
+
+  stats.requests += 1;
+  armed = true;
+  return true;
+}
+
+auto TcpRecvStream::wake() -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  if (not armed and close_is_waiting != nullptr) {
+    *close_is_waiting = false;
+  }
+}
+
+auto TcpRecvStream::resume() -> void {
+  if (not armed and not eof and not closing and success and ready.size() < options.max_queued) {
+    success = arm();
+  }
+}
+
+auto TcpRecvStream::io_received(std::uint32_t bytes_received) -> void {
+  armed = false;
+
+  if (bytes_received == 0) {
+    // closed
+    eof = true;
+    lease.release();
+    wake();
+    return;
+  }
+
+  stats.chunks += 1;
+  stats.bytes += bytes_received;
+  auto queued_back = ready.empty() ? nullptr : &ready.back();
+  if (bytes_received <= options.coalesce_below and queued_back != nullptr and
+      queued_back->buf.size() + bytes_received <= queued_back->lease.buf.size()) {
+    // the consumer has not seen the last chunk yet, grow it and keep the lease for the next receive
+    std::memcpy(queued_back->buf.data() + queued_back->buf.size(), lease.buf.data(), bytes_received);
+    queued_back->buf = {queued_back->buf.data(), queued_back->buf.size() + bytes_received};
+    stats.coalesced += 1;
+  } else {
+    auto buf = std::span<char>{lease.buf.data(), bytes_received};
+    ready.push_back({
+      .finished = true,
+      .success = true,
+      .lease = std::move(lease),
+      .buf = buf,
+    });
+  }
+
+  if (not closing) {
+    // keep the subscription armed unless the consumer fell behind
+    if (ready.size() < options.max_queued) {
+      success = arm();
+    } else {
+      stats.paused += 1;
+    }
+  }
+  wake();
+}
+
+auto TcpRecvStream::io_failed(std::uint32_t err_code) -> void {
+  armed = false;
+  lease.release();
+
+  if (closing and err_code == WSA_OPERATION_ABORTED) {
+    wake();
+    return;
+  }
+
+  success = false;
+  wake();
+  std::cerr << utils::with_location(std::format("TcpRecvStream compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// Send
+namespace cotask {
+
+TcpSend::TcpSend(TcpSocket *sock, std::span<const char> buf) : tcp_socket{*sock}, ts{sock->ts}, buf{buf} {
+  IMPL_CONSTRUCT(this);
+
+  auto wsa_buf = WSABUF{
+    .len = static_cast<ULONG>(buf.size()),
+    .buf = const_cast<char *>(buf.data()),
+  };
+
+  // send
+  auto send_result = ::WSASend(tcp_socket.impl->socket, &wsa_buf, 1ul, (PULONG)&bytes_sent, 0, &impl->ovex, nullptr);
+  if (send_result != 0) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("WSASend failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return;
+    }
+  }
+
+  success = true;
+}
+
+TcpSend::~TcpSend() {
+  std::destroy_at(impl);
+}
+
+auto TcpSend::io_sent(std::uint32_t bytes_sent) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = true;
+  this->bytes_sent = bytes_sent;
+}
+
+auto TcpSend::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  std::cerr << utils::with_location(std::format("TcpSend compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// SendAll
+namespace cotask {
+
+TcpSendAll::TcpSendAll(TcpSocket *sock, std::span<const char> buf) : tcp_socket{*sock}, ts{sock->ts}, buf{buf} {
+  IMPL_CONSTRUCT(this);
+
+  if (not io_request()) {
+    return;
+  }
+
+  success = true;
+}
+
+TcpSendAll::~TcpSendAll() {
+  std::destroy_at(impl);
+}
+
+auto TcpSendAll::io_request() -> bool {
+  auto wsa_buf = WSABUF{
+    .len = static_cast<ULONG>(buf.size()),
+    .buf = const_cast<char *>(buf.data()),
+  };
+
+  // send
+  auto send_result = ::WSASend(tcp_socket.impl->socket, &wsa_buf, 1ul, (PULONG)&bytes_sent, 0, &impl->ovex, nullptr);
+  if (send_result != 0) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("WSASend failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+auto TcpSendAll::io_sent(std::uint32_t bytes_sent) -> void {
+  total_bytes_sent += bytes_sent;
+
+  // check finished
+  if (total_bytes_sent == buf.size()) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = true;
+    return;
+  }
+
+  // send more bytes
+  if (not io_request()) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = false;
+  }
+}
+
+auto TcpSendAll::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  std::cerr << utils::with_location(std::format("TcpSendAll compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// SendZeroCopy
+namespace cotask {
+
+// with SO_SNDBUF 0 winsock sends straight from the (locked) user buffer and completes the send
+// once the buffer is no longer needed, in flight sends keep the mode they were posted with
+static constexpr auto default_send_buffer_size = 64 * 1024;
+
+static auto set_zero_copy_send(TcpSocket &sock, bool enable) -> bool {
+  // the current mode comes from the socket, another copy of the TcpSocket may have changed it
+  auto current_size = 0;
+  auto size_len = static_cast<int>(sizeof(current_size));
+  if (::getsockopt(sock.impl->socket, SOL_SOCKET, SO_SNDBUF, (char *)&current_size, &size_len) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("getsockopt SO_SNDBUF failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+  if ((current_size == 0) == enable) {
+    return true;
+  }
+
+  if (enable) {
+    sock.impl->send_buffer_size = current_size;
+  } else if (sock.impl->send_buffer_size == 0) {
+    // enabled through another copy, fall back to the configured size
+    sock.impl->send_buffer_size = sock.options.send_buffer_size.value_or(default_send_buffer_size);
+  }
+
+  const auto size = enable ? 0 : sock.impl->send_buffer_size;
+  if (::setsockopt(sock.impl->socket, SOL_SOCKET, SO_SNDBUF, (const char *)&size, sizeof(size)) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("setsockopt SO_SNDBUF failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+  return true;
+}
+
+TcpSendZeroCopy::TcpSendZeroCopy(TcpSocket *sock, std::span<const char> buf, std::size_t threshold)
+    : tcp_socket{*sock}, ts{sock->ts}, buf{buf} {
+  IMPL_CONSTRUCT(this);
+
+  // falls back to a copying send if the mode can not be changed
+  const auto enable = buf.size() >= threshold;
+  zero_copy = set_zero_copy_send(tcp_socket, enable) and enable;
+
+  if (buf.empty()) {
+    finished = true;
+    success = true;
+    return;
+  }
+
+  if (not io_request()) {
+    return;
+  }
+
+  success = true;
+}
+
+TcpSendZeroCopy::~TcpSendZeroCopy() {
+  std::destroy_at(impl);
+}
+
+auto TcpSendZeroCopy::io_request() -> bool {
+  constexpr auto max_send_size = std::size_t{1024 * 1024 * 1024};
+  const auto remaining = buf.size() - total_bytes_sent;
+  auto wsa_buf = WSABUF{
+    .len = static_cast<ULONG>(remaining < max_send_size ? remaining : max_send_size),
+    .buf = const_cast<char *>(buf.data() + total_bytes_sent),
+  };
+  static_cast<OVERLAPPED &>(impl->ovex) = OVERLAPPED{};
+
+  // send
+  auto send_result = ::WSASend(tcp_socket.impl->socket, &wsa_buf, 1ul, nullptr, 0, &impl->ovex, nullptr);
+  if (send_result != 0) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("WSASend failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+auto TcpSendZeroCopy::io_sent(std::uint32_t bytes_sent) -> void {
+  total_bytes_sent += bytes_sent;
+
+  // check finished
+  if (total_bytes_sent == buf.size()) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = true;
+    return;
+  }
+
+  // send more bytes
+  if (not io_request()) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = false;
+  }
+}
+
+auto TcpSendZeroCopy::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  std::cerr << utils::with_location(std::format("TcpSendZeroCopy compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// SendV
+namespace cotask {
+
+TcpSendV::TcpSendV(TcpSocket *sock, std::span<const std::span<const char>> bufs, bool all)
+    : tcp_socket{*sock}, ts{sock->ts}, all{all}, bufs{bufs} {
+  IMPL_CONSTRUCT(this);
+
+  for (const auto buf : bufs) {
+    total_size += buf.size();
+  }
+  if (total_size == 0) {
+    finished = true;
+    success = true;
+    return;
+  }
+
+  if (not io_request()) {
+    return;
+  }
+
+  success = true;
+}
+
+TcpSendV::~TcpSendV() {
+  std::destroy_at(impl);
+}
+
+auto TcpSendV::io_request() -> bool {
+  impl->wsa_bufs.assign(bufs, total_bytes_sent);
+  static_cast<OVERLAPPED &>(impl->ovex) = OVERLAPPED{};
+
+  // send
+  auto send_result =
+    ::WSASend(tcp_socket.impl->socket, impl->wsa_bufs.bufs, impl->wsa_bufs.count, nullptr, 0, &impl->ovex, nullptr);
+  if (send_result != 0) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("WSASend failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+auto TcpSendV::io_sent(std::uint32_t bytes_sent) -> void {
+  total_bytes_sent += bytes_sent;
+
+  // check finished
+  if (not all or total_bytes_sent == total_size) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = true;
+    return;
+  }
+
+  // send more bytes
+  if (not io_request()) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = false;
+  }
+}
+
+auto TcpSendV::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  std::cerr << utils::with_location(std::format("TcpSendV compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// SendFile
+namespace cotask {
+
+TcpSendFile::TcpSendFile(TcpSocket *sock, FileReader *reader, std::uint64_t offset, std::uint64_t length,
+                         std::uint64_t timeout)
+    : tcp_socket{*sock}, ts{sock->ts}, reader{reader}, offset{offset}, length{length}, timer{timeout} {
+  IMPL_CONSTRUCT(this);
+
+  // send to the end of the file
+  if (length == 0) {
+    auto file_size = LARGE_INTEGER{};
+    if (not ::GetFileSizeEx(reader->impl->file_handle, &file_size)) {
+      const auto err_code = ::GetLastError();
+      std::cerr << utils::with_location(std::format("GetFileSizeEx failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return;
+    }
+    const auto file_end = static_cast<std::uint64_t>(file_size.QuadPart);
+    this->length = offset < file_end ? file_end - offset : 0;
+  }
+
+  if (this->length == 0) {
+    finished = true;
+    success = true;
+    return;
+  }
+
+  if (not io_request()) {
+    return;
+  }
+
+  if (timeout > 0) {
+    // create timer
+    timer.impl->timer = ::CreateThreadpoolTimer(
+      [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) {
+        auto awaitable = static_cast<TcpSendFile *>(context);
+
+        awaitable->timer.fn_on_ended = [=]() {
+          if (::CancelIoEx(std::bit_cast<HANDLE>(awaitable->tcp_socket.impl->socket), &awaitable->impl->ovex) == 0) {
+            const auto err_code = ::GetLastError();
+            std::cerr << utils::with_location(std::format("CancelIoEx failed: {}", err_code))
+                      << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+          }
+
+          awaitable->finished = false;
+          awaitable->success = false;
+        };
+
+        auto &ts = awaitable->ts;
+        ::PostQueuedCompletionStatus(ts.impl->iocp_handle, 0, std::bit_cast<ULONG_PTR>(&awaitable->timer), nullptr);
+      },
+      this, nullptr);
+
+    if (timer.impl->timer == nullptr) {
+      const auto err_code = ::GetLastError();
+      std::cerr << utils::with_location(std::format("CreateThreadpoolTimer failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return;
+    }
+
+    timer.start();
+  }
+
+  success = true;
+}
+
+TcpSendFile::~TcpSendFile() {
+  std::destroy_at(impl);
+}
+
+auto TcpSendFile::io_request() -> bool {
+  timer.start();
+
+  // TransmitFile sends at most INT_MAX - 1 bytes per call
+  constexpr auto max_chunk = std::uint64_t{0x7FFFFFFE};
+  const auto remain = length - total_bytes_sent;
+  const auto chunk = static_cast<DWORD>(remain < max_chunk ? remain : max_chunk);
+
+  // setup OVERLAPPED
+  const auto chunk_offset = offset + total_bytes_sent;
+  impl->ovex.Offset = static_cast<std::uint32_t>(chunk_offset);           // low 32bits
+  impl->ovex.OffsetHigh = static_cast<std::uint32_t>(chunk_offset >> 32); // high 32bits
+
+  // send
+  if (not ::TransmitFile(tcp_socket.impl->socket, reader->impl->file_handle, chunk, 0, &impl->ovex, nullptr, 0)) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING and err_code != ERROR_IO_PENDING) {
+      timer.close();
+      std::cerr << utils::with_location(std::format("TransmitFile failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+auto TcpSendFile::io_sent(std::uint32_t bytes_sent) -> void {
+  total_bytes_sent += bytes_sent;
+
+  // check finished
+  if (total_bytes_sent >= length or bytes_sent == 0) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = total_bytes_sent >= length;
+    timer.close();
+    return;
+  }
+
+  // send more bytes
+  if (not io_request()) {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    success = false;
+  }
+}
+
+auto TcpSendFile::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+  timer.close();
+
+  std::cerr << utils::with_location(std::format("TcpSendFile compeletion failed: {}", err_code))
             << std::format("err msg: {}\n", std::system_category().message((int)err_code));
 }
 
@@ -3,9 +3,11 @@
 #include <cotask/tcp.hpp>
 
 #include <bit>
+#include <vector>
 
 #include <winsock2.h>
 #include <mswsock.h>
+#include <mstcpip.h>
 
 // TODO: make Reader Writer API
 
@@ -17,6 +19,10 @@ struct TcpSocket::Impl {
   LPFN_CONNECTEX fnConnectEx = nullptr;
   // TODO: DisconnectEx
 
+  // SO_SNDBUF is 0 while zero copy sends are enabled (the mode is read from the socket, copies share it),
+  // the size seen before enabling is restored for copying sends
+  int send_buffer_size = 0;
+
   inline Impl() = default;
   inline Impl(const Impl &other) = default;
 
@@ -26,6 +32,7 @@ struct TcpSocket::Impl {
     }
     this->socket = other.socket;
     this->fnConnectEx = other.fnConnectEx;
+    this->send_buffer_size = other.send_buffer_size;
     return *this;
   }
 
@@ -36,6 +43,48 @@ struct TcpSocket::Impl {
 
 } // namespace cotask
 
+// WSABUF array over a list of buffers
+namespace cotask {
+
+struct WsaBufList {
+  static constexpr auto inline_count = std::size_t{8};
+
+  WSABUF inline_bufs[inline_count]{};
+  std::vector<WSABUF> heap_bufs;
+  WSABUF *bufs = inline_bufs;
+  ULONG count = 0;
+
+  // skips the first `offset` bytes (already transferred)
+  template <typename T>
+  inline auto assign(std::span<const std::span<T>> spans, std::size_t offset) -> void {
+    auto first = std::size_t{0};
+    while (first < spans.size() and offset >= spans[first].size()) {
+      offset -= spans[first].size();
+      first += 1;
+    }
+
+    const auto n = spans.size() - first;
+    if (n > inline_count) {
+      heap_bufs.resize(n);
+      bufs = heap_bufs.data();
+    } else {
+      bufs = inline_bufs;
+    }
+
+    for (auto i = std::size_t{0}; i < n; ++i) {
+      const auto span = spans[first + i];
+      const auto skip = i == 0 ? offset : 0;
+      bufs[i] = WSABUF{
+        .len = static_cast<ULONG>(span.size() - skip),
+        .buf = const_cast<char *>(span.data() + skip),
+      };
+    }
+    count = static_cast<ULONG>(n);
+  }
+};
+
+} // namespace cotask
+
 // Accept
 namespace cotask {
 
@@ -57,6 +106,29 @@ struct TcpAccept::Impl {
 
 } // namespace cotask
 
+// AcceptStream
+namespace cotask {
+
+struct OverlappedTcpAcceptStream : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::AcceptStream;
+  AcceptStream *stream;
+  std::size_t slot;
+
+  SOCKET socket = INVALID_SOCKET;
+  alignas(8) std::uint8_t addr_buf[88]{};
+  DWORD bytes_received = 0;
+
+  inline OverlappedTcpAcceptStream(AcceptStream *stream, std::size_t slot)
+      : OVERLAPPED{}, stream{stream}, slot{slot} {}
+};
+
+struct AcceptStream::Impl {
+  // one overlapped per armed accept, heap allocated so the addresses stay stable
+  std::vector<std::unique_ptr<OverlappedTcpAcceptStream>> slots;
+};
+
+} // namespace cotask
+
 // Connect
 namespace cotask {
 
@@ -69,6 +141,7 @@ struct OverlappedTcpConnect : public OVERLAPPED {
 
 struct TcpConnect::Impl {
   OverlappedTcpConnect ovex;
+  bool resolving = false; // registered as a dns waiter
 
   inline explicit Impl(TcpConnect *awaitable) : ovex{awaitable} {}
 };
@@ -111,6 +184,61 @@ struct TcpRecvAll::Impl {
 
 } // namespace cotask
 
+// RecvV
+namespace cotask {
+
+struct OverlappedTcpRecvV : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::RecvV;
+  TcpRecvV *awaitable;
+
+  inline explicit OverlappedTcpRecvV(TcpRecvV *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct TcpRecvV::Impl {
+  OverlappedTcpRecvV ovex;
+  WsaBufList wsa_bufs;
+
+  inline explicit Impl(TcpRecvV *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
+
+// RecvPooled
+namespace cotask {
+
+struct OverlappedTcpRecvPooled : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::RecvPooled;
+  TcpRecvPooled *awaitable;
+
+  inline explicit OverlappedTcpRecvPooled(TcpRecvPooled *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct TcpRecvPooled::Impl {
+  OverlappedTcpRecvPooled ovex;
+
+  inline explicit Impl(TcpRecvPooled *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
+
+// RecvStream
+namespace cotask {
+
+struct OverlappedTcpRecvStream : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::RecvStream;
+  TcpRecvStream *stream;
+
+  inline explicit OverlappedTcpRecvStream(TcpRecvStream *stream) : OVERLAPPED{}, stream{stream} {}
+};
+
+struct TcpRecvStream::Impl {
+  OverlappedTcpRecvStream ovex;
+
+  inline explicit Impl(TcpRecvStream *stream) : ovex{stream} {}
+};
+
+} // namespace cotask
+
 // Send
 namespace cotask {
 
@@ -146,3 +274,58 @@ struct TcpSendAll::Impl {
 };
 
 } // namespace cotask
+
+// SendZeroCopy
+namespace cotask {
+
+struct OverlappedTcpSendZeroCopy : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::SendZeroCopy;
+  TcpSendZeroCopy *awaitable;
+
+  inline explicit OverlappedTcpSendZeroCopy(TcpSendZeroCopy *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct TcpSendZeroCopy::Impl {
+  OverlappedTcpSendZeroCopy ovex;
+
+  inline explicit Impl(TcpSendZeroCopy *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
+
+// SendV
+namespace cotask {
+
+struct OverlappedTcpSendV : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::SendV;
+  TcpSendV *awaitable;
+
+  inline explicit OverlappedTcpSendV(TcpSendV *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct TcpSendV::Impl {
+  OverlappedTcpSendV ovex;
+  WsaBufList wsa_bufs;
+
+  inline explicit Impl(TcpSendV *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
+
+// SendFile
+namespace cotask {
+
+struct OverlappedTcpSendFile : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::SendFile;
+  TcpSendFile *awaitable;
+
+  inline explicit OverlappedTcpSendFile(TcpSendFile *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct TcpSendFile::Impl {
+  OverlappedTcpSendFile ovex;
+
+  inline explicit Impl(TcpSendFile *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
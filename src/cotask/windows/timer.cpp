@@ -1,6 +1,13 @@
+#include "cotask.hpp"
 #include "timer.hpp"
 
 #include <cotask/impl.hpp>
+#include <cotask/utils.hpp>
+
+#include <bit>
+#include <format>
+#include <iostream>
+#include <system_error>
 
 namespace cotask {
 
@@ -37,3 +44,61 @@ auto Timer::close() -> void {
 }
 
 } // namespace cotask
+
+// Sleep
+namespace cotask {
+
+TimerSleep::TimerSleep(TaskScheduler &ts, std::chrono::microseconds duration) : ts{ts}, timer{0} {
+  timer.is_waiting = nullptr;
+  if (duration.count() <= 0) {
+    timer.ended = true;
+    return;
+  }
+
+  // relative due time in 100 ns units
+  auto due_time = ULARGE_INTEGER{.QuadPart = static_cast<ULONGLONG>(-(duration.count() * 10))};
+  timer.impl->due_time.dwHighDateTime = due_time.HighPart;
+  timer.impl->due_time.dwLowDateTime = due_time.LowPart;
+}
+
+auto TimerSleep::start() -> void {
+  started = true;
+  timer.impl->timer = ::CreateThreadpoolTimer(
+    [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) {
+      auto sleep = static_cast<TimerSleep *>(context);
+      sleep->fired.store(true);
+      auto &ts = sleep->ts;
+      ::PostQueuedCompletionStatus(ts.impl->iocp_handle, 0, std::bit_cast<ULONG_PTR>(&sleep->timer), nullptr);
+    },
+    this, nullptr);
+
+  if (timer.impl->timer == nullptr) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("CreateThreadpoolTimer failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    // resume right away instead of sleeping forever
+    timer.on_ended();
+    return;
+  }
+
+  timer.start();
+}
+
+auto TimerSleep::cancel() -> void {
+  if (timer.ended) {
+    return;
+  }
+  if (not started) {
+    timer.ended = true;
+    return;
+  }
+
+  // stops the timer and waits for a callback in progress
+  timer.close();
+  if (not fired.load()) {
+    timer.on_ended();
+  }
+  // otherwise the posted completion resumes the sleep
+}
+
+} // namespace cotask
@@ -0,0 +1,349 @@
+#include "cotask.hpp"
+#include "udp.hpp"
+
+#include <cotask/impl.hpp>
+#include <cotask/utils.hpp>
+
+#include <iostream>
+
+// UdpAddress
+namespace cotask {
+
+auto UdpAddress::from_string(std::string_view ip, std::uint16_t port) -> UdpAddress {
+  auto address = UdpAddress{};
+  auto ip_str = std::string{ip};
+  auto in_addr = IN_ADDR{};
+  if (::inet_pton(AF_INET, ip_str.c_str(), &in_addr) != 1) {
+    std::cerr << utils::with_location(std::format("invalid ipv4 address: {}", ip_str));
+    return address;
+  }
+  address.ip = in_addr.S_un.S_addr;
+  address.port = port;
+  return address;
+}
+
+auto UdpAddress::to_string() const -> std::string {
+  auto in_addr = IN_ADDR{};
+  in_addr.S_un.S_addr = ip;
+  char buf[INET_ADDRSTRLEN]{};
+  if (::inet_ntop(AF_INET, &in_addr, buf, sizeof(buf)) == nullptr) {
+    return {};
+  }
+  return std::format("{}:{}", buf, port);
+}
+
+} // namespace cotask
+
+// UdpSocket
+namespace cotask {
+
+UdpSocket::UdpSocket(TaskScheduler &ts) : ts{ts} {
+  IMPL_CONSTRUCT();
+}
+
+UdpSocket::~UdpSocket() {
+  std::destroy_at(impl);
+}
+
+auto UdpSocket::bind(std::uint16_t port) -> bool {
+  // create socket
+  impl->socket = ::WSASocketW(AF_INET, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+  if (impl->socket == INVALID_SOCKET) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("WSASocketW failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  // get WSARecvMsg function pointer
+  auto guid = GUID WSAID_WSARECVMSG;
+  auto bytes = DWORD{};
+  if (::WSAIoctl(impl->socket, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid), &impl->fnWSARecvMsg,
+                 sizeof(impl->fnWSARecvMsg), &bytes, nullptr, nullptr) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("WSARecvMsg load failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    close();
+    return false;
+  }
+
+  // an ICMP port unreachable must not fail the next receive
+  auto connreset = FALSE;
+  ::WSAIoctl(impl->socket, SIO_UDP_CONNRESET, &connreset, sizeof(connreset), nullptr, 0, &bytes, nullptr, nullptr);
+
+  // bind
+  auto addr = SOCKADDR_IN{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.S_un.S_addr = ::htonl(INADDR_ANY);
+  addr.sin_port = ::htons(port);
+  if (::bind(impl->socket, (SOCKADDR *)&addr, sizeof(addr)) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("socket bind failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    close();
+    return false;
+  }
+
+  // non blocking: batches drain and send without waiting, overlapped requests are not affected
+  auto non_blocking = ULONG{1};
+  if (::ioctlsocket(impl->socket, FIONBIO, &non_blocking) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("ioctlsocket failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    close();
+    return false;
+  }
+
+  // setup IOCP
+  if (not ::CreateIoCompletionPort(impl->get_handle(), ts.impl->iocp_handle, (ULONG_PTR)this, 0)) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("CreateIoCompletionPort failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+auto UdpSocket::close() -> bool {
+  if (impl->socket == INVALID_SOCKET) {
+    return true;
+  }
+
+  if (::closesocket(impl->socket) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("closesocket failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  impl->socket = INVALID_SOCKET;
+  return true;
+}
+
+auto UdpSocket::enable_gro(std::uint32_t max_coalesced_size) -> bool {
+  // URO, the windows receive offload
+  auto size = DWORD{max_coalesced_size};
+  if (::setsockopt(impl->socket, IPPROTO_UDP, UDP_RECV_MAX_COALESCED_SIZE, (const char *)&size, sizeof(size)) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("setsockopt UDP_RECV_MAX_COALESCED_SIZE failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  if (max_datagram_size < max_coalesced_size) {
+    max_datagram_size = max_coalesced_size;
+  }
+  return true;
+}
+
+} // namespace cotask
+
+// RecvBatch
+namespace cotask {
+
+UdpRecvBatch::UdpRecvBatch(UdpSocket *sock, std::span<UdpDatagram> datagrams)
+    : udp_socket{*sock}, ts{sock->ts}, datagrams{datagrams} {
+  IMPL_CONSTRUCT(this);
+
+  if (datagrams.empty()) {
+    finished = true;
+    success = true;
+    return;
+  }
+
+  // wait for the first datagram
+  prepare(0);
+  auto recv_result = udp_socket.impl->fnWSARecvMsg(udp_socket.impl->socket, &impl->msg, nullptr, &impl->ovex, nullptr);
+  if (recv_result != 0) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("WSARecvMsg failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      return;
+    }
+  }
+
+  success = true;
+}
+
+UdpRecvBatch::~UdpRecvBatch() {
+  std::destroy_at(impl);
+}
+
+auto UdpRecvBatch::prepare(std::size_t index) -> void {
+  auto &datagram = datagrams[index];
+  if (datagram.buf.empty()) {
+    datagram.lease = ts.aligned_buffers.acquire(udp_socket.max_datagram_size);
+    datagram.buf = datagram.lease.buf.first(udp_socket.max_datagram_size);
+  }
+  datagram.size = 0;
+  datagram.segment_size = 0;
+
+  impl->wsa_buf = WSABUF{
+    .len = static_cast<ULONG>(datagram.buf.size()),
+    .buf = datagram.buf.data(),
+  };
+  impl->from = SOCKADDR_IN{};
+  impl->msg = WSAMSG{
+    .name = (SOCKADDR *)&impl->from,
+    .namelen = sizeof(impl->from),
+    .lpBuffers = &impl->wsa_buf,
+    .dwBufferCount = 1,
+    .Control = {.len = sizeof(impl->control), .buf = impl->control},
+    .dwFlags = 0,
+  };
+}
+
+auto UdpRecvBatch::complete(std::size_t index, std::uint32_t bytes_received) -> void {
+  auto &datagram = datagrams[index];
+  datagram.size = bytes_received;
+  datagram.address = {
+    .ip = impl->from.sin_addr.S_un.S_addr,
+    .port = ::ntohs(impl->from.sin_port),
+  };
+
+  // coalesced datagrams (URO) report their segment size
+  for (auto cmsg = WSA_CMSG_FIRSTHDR(&impl->msg); cmsg != nullptr; cmsg = WSA_CMSG_NXTHDR(&impl->msg, cmsg)) {
+    if (cmsg->cmsg_level == IPPROTO_UDP and cmsg->cmsg_type == UDP_COALESCED_INFO) {
+      datagram.segment_size = *reinterpret_cast<const DWORD *>(WSA_CMSG_DATA(cmsg));
+    }
+  }
+}
+
+auto UdpRecvBatch::io_received(std::uint32_t bytes_received) -> void {
+  complete(0, bytes_received);
+  count = 1;
+
+  // take what is already queued without waiting
+  while (count < datagrams.size()) {
+    prepare(count);
+    auto bytes = DWORD{};
+    if (udp_socket.impl->fnWSARecvMsg(udp_socket.impl->socket, &impl->msg, &bytes, nullptr, nullptr) != 0) {
+      const auto err_code = ::WSAGetLastError();
+      if (err_code != WSAEWOULDBLOCK) {
+        std::cerr << utils::with_location(std::format("WSARecvMsg failed: {}", err_code))
+                  << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      }
+      break;
+    }
+    complete(count, bytes);
+    count += 1;
+  }
+
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = true;
+}
+
+auto UdpRecvBatch::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  std::cerr << utils::with_location(std::format("UdpRecvBatch compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// SendBatch
+namespace cotask {
+
+UdpSendBatch::UdpSendBatch(UdpSocket *sock, std::span<const UdpDatagram> datagrams)
+    : udp_socket{*sock}, ts{sock->ts}, datagrams{datagrams} {
+  IMPL_CONSTRUCT(this);
+
+  success = true;
+  send_all();
+}
+
+UdpSendBatch::~UdpSendBatch() {
+  std::destroy_at(impl);
+}
+
+auto UdpSendBatch::prepare(std::size_t index) -> void {
+  const auto &datagram = datagrams[index];
+
+  impl->wsa_buf = WSABUF{
+    .len = static_cast<ULONG>(datagram.size),
+    .buf = datagram.buf.data(),
+  };
+  impl->to = SOCKADDR_IN{};
+  impl->to.sin_family = AF_INET;
+  impl->to.sin_addr.S_un.S_addr = datagram.address.ip;
+  impl->to.sin_port = ::htons(datagram.address.port);
+  impl->msg = WSAMSG{
+    .name = (SOCKADDR *)&impl->to,
+    .namelen = sizeof(impl->to),
+    .lpBuffers = &impl->wsa_buf,
+    .dwBufferCount = 1,
+    .Control = {.len = 0, .buf = nullptr},
+    .dwFlags = 0,
+  };
+
+  // USO, the windows segmentation offload: the stack splits the buffer into `segment_size` datagrams
+  if (datagram.segment_size > 0 and datagram.size > datagram.segment_size) {
+    auto cmsg = reinterpret_cast<WSACMSGHDR *>(impl->control);
+    cmsg->cmsg_len = WSA_CMSG_LEN(sizeof(DWORD));
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEND_MSG_SIZE;
+    *reinterpret_cast<DWORD *>(WSA_CMSG_DATA(cmsg)) = datagram.segment_size;
+    impl->msg.Control = {.len = sizeof(impl->control), .buf = impl->control};
+  }
+}
+
+auto UdpSendBatch::send_all() -> void {
+  while (count < datagrams.size()) {
+    prepare(count);
+
+    auto bytes = DWORD{};
+    if (::WSASendMsg(udp_socket.impl->socket, &impl->msg, 0, &bytes, nullptr, nullptr) == 0) {
+      count += 1;
+      continue;
+    }
+
+    auto err_code = ::WSAGetLastError();
+    if (err_code == WSAEWOULDBLOCK) {
+      // send buffer is full, wait for this one to complete
+      if (::WSASendMsg(udp_socket.impl->socket, &impl->msg, 0, nullptr, &impl->ovex, nullptr) == 0) {
+        return;
+      }
+      err_code = ::WSAGetLastError();
+      if (err_code == WSA_IO_PENDING) {
+        return;
+      }
+    }
+
+    io_failed(static_cast<std::uint32_t>(err_code));
+    return;
+  }
+
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+}
+
+auto UdpSendBatch::io_sent(std::uint32_t) -> void {
+  count += 1;
+  send_all();
+}
+
+auto UdpSendBatch::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  std::cerr << utils::with_location(std::format("UdpSendBatch compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
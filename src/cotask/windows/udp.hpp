@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cotask/udp.hpp>
+
+#include "cotask.hpp"
+
+#include <bit>
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mswsock.h>
+#include <mstcpip.h>
+
+// UDP segmentation / receive coalescing offload (ws2ipdef.h, Windows 10 2004+)
+#ifndef UDP_SEND_MSG_SIZE
+#define UDP_SEND_MSG_SIZE 2
+#endif
+#ifndef UDP_RECV_MAX_COALESCED_SIZE
+#define UDP_RECV_MAX_COALESCED_SIZE 3
+#endif
+#ifndef UDP_COALESCED_INFO
+#define UDP_COALESCED_INFO 3
+#endif
+
+// UdpSocket
+namespace cotask {
+
+struct UdpSocket::Impl {
+  SOCKET socket = INVALID_SOCKET;
+  LPFN_WSARECVMSG fnWSARecvMsg = nullptr;
+
+  inline auto get_handle() -> HANDLE {
+    return std::bit_cast<HANDLE>(socket);
+  }
+};
+
+} // namespace cotask
+
+// RecvBatch
+namespace cotask {
+
+struct OverlappedUdpRecvBatch : public OVERLAPPED {
+  const UdpIoType type = UdpIoType::RecvBatch;
+  UdpRecvBatch *awaitable;
+
+  inline explicit OverlappedUdpRecvBatch(UdpRecvBatch *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct UdpRecvBatch::Impl {
+  OverlappedUdpRecvBatch ovex;
+  WSAMSG msg{};
+  WSABUF wsa_buf{};
+  SOCKADDR_IN from{};
+  char control[WSA_CMSG_SPACE(sizeof(DWORD))]{};
+
+  inline explicit Impl(UdpRecvBatch *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
+
+// SendBatch
+namespace cotask {
+
+struct OverlappedUdpSendBatch : public OVERLAPPED {
+  const UdpIoType type = UdpIoType::SendBatch;
+  UdpSendBatch *awaitable;
+
+  inline explicit OverlappedUdpSendBatch(UdpSendBatch *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct UdpSendBatch::Impl {
+  OverlappedUdpSendBatch ovex;
+  WSAMSG msg{};
+  WSABUF wsa_buf{};
+  SOCKADDR_IN to{};
+  char control[WSA_CMSG_SPACE(sizeof(DWORD))]{};
+
+  inline explicit Impl(UdpSendBatch *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
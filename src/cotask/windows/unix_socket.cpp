@@ -0,0 +1,371 @@
+#include "cotask.hpp"
+#include "tcp.hpp"
+#include "unix_socket.hpp"
+
+#include <cotask/impl.hpp>
+#include <cotask/utils.hpp>
+
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <filesystem>
+
+// UnixSocket
+namespace cotask {
+
+static auto to_unix_addr(std::string_view path, SOCKADDR_UN &addr) -> bool {
+  if (path.empty() or path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << utils::with_location(std::format("invalid unix socket path: {}", path));
+    return false;
+  }
+
+  addr = SOCKADDR_UN{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.data(), path.size());
+  return true;
+}
+
+UnixSocket::UnixSocket(TaskScheduler &ts) : TcpSocket{ts} {}
+
+auto UnixSocket::listen(std::string_view path) -> bool {
+  auto addr = SOCKADDR_UN{};
+  if (not to_unix_addr(path, addr)) {
+    return false;
+  }
+
+  // create socket
+  impl->socket = ::WSASocketW(AF_UNIX, SOCK_STREAM, 0, nullptr, 0, WSA_FLAG_OVERLAPPED);
+  if (impl->socket == INVALID_SOCKET) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("WSASocketW failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return false;
+  }
+
+  // bind, the socket file of a previous run would fail it
+  auto ec = std::error_code{};
+  std::filesystem::remove(std::filesystem::path{path}, ec);
+  if (::bind(impl->socket, (SOCKADDR *)&addr, sizeof(addr)) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("socket bind failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    ::closesocket(impl->socket);
+    return false;
+  }
+  this->path = path;
+
+  // setup IOCP
+  if (not ::CreateIoCompletionPort(impl->get_handle(), ts.impl->iocp_handle, (ULONG_PTR)this, 0)) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("CreateIoCompletionPort failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    close();
+    return false;
+  }
+
+  // listen
+  if (::listen(impl->socket, SOMAXCONN) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("listen failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+auto UnixSocket::close() -> bool {
+  const auto closed = TcpSocket::close();
+  if (not path.empty()) {
+    auto ec = std::error_code{};
+    std::filesystem::remove(std::filesystem::path{path}, ec);
+    path.clear();
+  }
+  return closed;
+}
+
+auto UnixSocket::peer_process_id() const -> std::uint32_t {
+  auto pid = ULONG{};
+  auto bytes = DWORD{};
+  if (::WSAIoctl(impl->socket, SIO_AF_UNIX_GETPEERPID, nullptr, 0, &pid, sizeof(pid), &bytes, nullptr, nullptr) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("SIO_AF_UNIX_GETPEERPID failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return 0;
+  }
+  return pid;
+}
+
+} // namespace cotask
+
+// handle passing
+namespace cotask {
+
+// there is no SCM_RIGHTS, handles are duplicated into the peer process and their values sent over the stream
+auto UnixSocket::send_socket(TaskScheduler &, UnixSocket *sock, TcpSocket *passed) -> Task<bool> {
+  const auto pid = sock->peer_process_id();
+  if (pid == 0) {
+    co_return false;
+  }
+
+  auto message = UnixHandleMessage{.kind = UnixHandleKind::Socket};
+  if (::WSADuplicateSocketW(passed->impl->socket, pid, &message.protocol_info) != 0) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("WSADuplicateSocketW failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    co_return false;
+  }
+
+  auto send_result = co_await TcpSendAll{sock, {reinterpret_cast<const char *>(&message), sizeof(message)}};
+  co_return send_result.success;
+}
+
+auto UnixSocket::recv_socket(TaskScheduler &ts, UnixSocket *sock, TcpSocket *received) -> Task<bool> {
+  auto message = UnixHandleMessage{};
+  auto recv_result = co_await TcpRecvAll{sock, {reinterpret_cast<char *>(&message), sizeof(message)}};
+  if (not recv_result.success) {
+    co_return false;
+  }
+  if (message.kind != UnixHandleKind::Socket) {
+    std::cerr << utils::with_location("expected a socket, received a handle");
+    ::CloseHandle(reinterpret_cast<HANDLE>(message.handle));
+    co_return false;
+  }
+
+  received->impl->socket = ::WSASocketW(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO,
+                                        &message.protocol_info, 0, WSA_FLAG_OVERLAPPED);
+  if (received->impl->socket == INVALID_SOCKET) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("WSASocketW failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    co_return false;
+  }
+
+  // setup IOCP
+  if (not ::CreateIoCompletionPort(received->impl->get_handle(), ts.impl->iocp_handle, (ULONG_PTR)received, 0)) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("CreateIoCompletionPort failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    received->close();
+    co_return false;
+  }
+
+  co_return true;
+}
+
+auto UnixSocket::send_handle(TaskScheduler &, UnixSocket *sock, void *handle) -> Task<bool> {
+  const auto pid = sock->peer_process_id();
+  if (pid == 0) {
+    co_return false;
+  }
+
+  auto process = ::OpenProcess(PROCESS_DUP_HANDLE, FALSE, pid);
+  if (process == nullptr) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("OpenProcess failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    co_return false;
+  }
+
+  auto duplicated = HANDLE{};
+  if (not ::DuplicateHandle(::GetCurrentProcess(), handle, process, &duplicated, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("DuplicateHandle failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    ::CloseHandle(process);
+    co_return false;
+  }
+
+  auto message = UnixHandleMessage{
+    .kind = UnixHandleKind::Handle,
+    .handle = reinterpret_cast<std::uint64_t>(duplicated),
+  };
+  auto send_result = co_await TcpSendAll{sock, {reinterpret_cast<const char *>(&message), sizeof(message)}};
+  if (not send_result.success) {
+    // the peer never learns the value, close it in the peer process
+    ::DuplicateHandle(process, duplicated, nullptr, nullptr, 0, FALSE, DUPLICATE_CLOSE_SOURCE);
+  }
+  ::CloseHandle(process);
+  co_return send_result.success;
+}
+
+auto UnixSocket::recv_handle(TaskScheduler &, UnixSocket *sock) -> Task<UnixRecvHandleResult> {
+  auto message = UnixHandleMessage{};
+  auto recv_result = co_await TcpRecvAll{sock, {reinterpret_cast<char *>(&message), sizeof(message)}};
+  if (not recv_result.success) {
+    co_return UnixRecvHandleResult{};
+  }
+  if (message.kind != UnixHandleKind::Handle) {
+    std::cerr << utils::with_location("expected a handle, received a socket");
+    co_return UnixRecvHandleResult{};
+  }
+
+  co_return UnixRecvHandleResult{.success = true, .handle = reinterpret_cast<void *>(message.handle)};
+}
+
+} // namespace cotask
+
+// Accept
+namespace cotask {
+
+UnixAccept::UnixAccept(UnixSocket *sock, UnixSocket *accept_socket)
+    : unix_socket{*sock}, accept_socket{*accept_socket}, ts{sock->ts} {
+  IMPL_CONSTRUCT(this);
+
+  // create socket
+  auto conn_socket = ::WSASocketW(AF_UNIX, SOCK_STREAM, 0, nullptr, 0, WSA_FLAG_OVERLAPPED);
+  if (conn_socket == INVALID_SOCKET) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("WSASocketW failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return;
+  }
+
+  // accept, completes on the listener like the other tcp ops
+  auto accept_success = ::AcceptEx(unix_socket.impl->socket, conn_socket, impl->addr_buf, 0,
+                                   sizeof(impl->addr_buf) / 2, sizeof(impl->addr_buf) / 2, &impl->bytes_received,
+                                   &impl->ovex);
+  if (not accept_success) {
+    const auto err_code = ::WSAGetLastError();
+    if (err_code != WSA_IO_PENDING) {
+      std::cerr << utils::with_location(std::format("AcceptEx failed: {}", err_code))
+                << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+      ::closesocket(conn_socket);
+      return;
+    }
+  }
+
+  success = true;
+  this->accept_socket.impl->socket = conn_socket;
+}
+
+UnixAccept::~UnixAccept() {
+  std::destroy_at(impl);
+}
+
+auto UnixAccept::io_accepted(std::uint32_t) -> void {
+  // inherit the listening socket properties (peer process id, shutdown)
+  ::setsockopt(accept_socket.impl->socket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+               (const char *)&unix_socket.impl->socket, sizeof(unix_socket.impl->socket));
+
+  // setup IOCP
+  if (not ::CreateIoCompletionPort(accept_socket.impl->get_handle(), ts.impl->iocp_handle,
+                                   (ULONG_PTR)&accept_socket, 0)) {
+    const auto err_code = ::GetLastError();
+    io_failed(err_code);
+    return;
+  }
+
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = true;
+}
+
+auto UnixAccept::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  accept_socket.close();
+
+  std::cerr << utils::with_location(std::format("UnixAccept compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
+
+// Connect
+namespace cotask {
+
+UnixConnect::UnixConnect(UnixSocket *sock, std::string_view path) : unix_socket{*sock}, ts{sock->ts} {
+  IMPL_CONSTRUCT(this);
+
+  auto &ovex = impl->ovex;
+  if (not to_unix_addr(path, ovex.addr)) {
+    return;
+  }
+
+  // create socket
+  unix_socket.impl->socket = ::WSASocketW(AF_UNIX, SOCK_STREAM, 0, nullptr, 0, WSA_FLAG_OVERLAPPED);
+  if (unix_socket.impl->socket == INVALID_SOCKET) {
+    const auto err_code = ::WSAGetLastError();
+    std::cerr << utils::with_location(std::format("WSASocketW failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    return;
+  }
+
+  ovex.iocp_handle = ts.impl->iocp_handle;
+  ovex.socket = unix_socket.impl->socket;
+  ovex.work = ::CreateThreadpoolWork(
+    [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+      auto ovex = static_cast<OverlappedTcpUnixConnect *>(context);
+
+      if (::connect(ovex->socket, (const SOCKADDR *)&ovex->addr, sizeof(ovex->addr)) != 0) {
+        ovex->err_code = static_cast<DWORD>(::WSAGetLastError());
+      }
+
+      auto sock = static_cast<TcpSocket *>(&ovex->awaitable->unix_socket);
+      ::PostQueuedCompletionStatus(ovex->iocp_handle, 0, std::bit_cast<ULONG_PTR>(sock), ovex);
+    },
+    &ovex, nullptr);
+
+  if (ovex.work == nullptr) {
+    const auto err_code = ::GetLastError();
+    std::cerr << utils::with_location(std::format("CreateThreadpoolWork failed: {}", err_code))
+              << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+    unix_socket.TcpSocket::close();
+    return;
+  }
+
+  ::SubmitThreadpoolWork(ovex.work);
+  success = true;
+}
+
+UnixConnect::~UnixConnect() {
+  if (impl->ovex.work != nullptr) {
+    ::WaitForThreadpoolWorkCallbacks(impl->ovex.work, FALSE);
+    ::CloseThreadpoolWork(impl->ovex.work);
+  }
+  std::destroy_at(impl);
+}
+
+auto UnixConnect::io_connected() -> void {
+  if (impl->ovex.err_code != 0) {
+    unix_socket.TcpSocket::close();
+    io_failed(impl->ovex.err_code);
+    return;
+  }
+
+  // setup IOCP
+  if (not ::CreateIoCompletionPort(unix_socket.impl->get_handle(), ts.impl->iocp_handle, (ULONG_PTR)&unix_socket,
+                                   0)) {
+    const auto err_code = ::GetLastError();
+    unix_socket.TcpSocket::close();
+    io_failed(err_code);
+    return;
+  }
+
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = true;
+}
+
+auto UnixConnect::io_failed(std::uint32_t err_code) -> void {
+  if (is_waiting != nullptr) {
+    *is_waiting = false;
+  }
+  finished = true;
+  success = false;
+
+  std::cerr << utils::with_location(std::format("UnixConnect compeletion failed: {}", err_code))
+            << std::format("err msg: {}\n", std::system_category().message((int)err_code));
+}
+
+} // namespace cotask
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cotask/unix_socket.hpp>
+
+#include "cotask.hpp"
+#include "tcp.hpp"
+
+#include <winsock2.h>
+#include <afunix.h>
+
+// handle passing
+namespace cotask {
+
+enum struct UnixHandleKind : std::uint32_t {
+  Socket = 1,
+  Handle = 2,
+};
+
+// fixed size, sent as is over the stream
+struct UnixHandleMessage {
+  UnixHandleKind kind;
+  std::uint32_t reserved = 0;
+  std::uint64_t handle = 0;             // `Handle`: value in the receiving process
+  WSAPROTOCOL_INFOW protocol_info = {}; // `Socket`: duplicated for the receiving process
+};
+
+} // namespace cotask
+
+// Accept
+namespace cotask {
+
+struct OverlappedTcpUnixAccept : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::UnixAccept;
+  UnixAccept *awaitable;
+
+  inline explicit OverlappedTcpUnixAccept(UnixAccept *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct UnixAccept::Impl {
+  OverlappedTcpUnixAccept ovex;
+
+  // local and remote address, each needs 16 bytes more than the address
+  alignas(8) std::uint8_t addr_buf[2 * (sizeof(SOCKADDR_UN) + 16)]{};
+  DWORD bytes_received = 0;
+
+  inline explicit Impl(UnixAccept *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
+
+// Connect
+namespace cotask {
+
+struct OverlappedTcpUnixConnect : public OVERLAPPED {
+  const TcpIoType type = TcpIoType::UnixConnect;
+  UnixConnect *awaitable;
+  HANDLE iocp_handle = nullptr;
+  PTP_WORK work = nullptr;
+
+  SOCKET socket = INVALID_SOCKET;
+  SOCKADDR_UN addr{};
+  DWORD err_code = 0;
+
+  inline explicit OverlappedTcpUnixConnect(UnixConnect *awaitable) : OVERLAPPED{}, awaitable{awaitable} {}
+};
+
+struct UnixConnect::Impl {
+  OverlappedTcpUnixConnect ovex;
+
+  inline explicit Impl(UnixConnect *awaitable) : ovex{awaitable} {}
+};
+
+} // namespace cotask
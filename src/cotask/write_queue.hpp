@@ -0,0 +1,279 @@
+#pragma once
+
+#include <cotask/cotask.hpp>
+#include <cotask/tcp.hpp>
+
+#include <span>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace cotask {
+
+struct TcpWriteQueue;
+struct TcpWriteQueueClose;
+
+struct TcpWriteQueueOptions {
+  // writers wait once more than `high_water` bytes are queued, until the queue drains below `low_water`
+  std::size_t high_water = 1024 * 1024;
+  std::size_t low_water = 256 * 1024;
+  std::size_t max_batch_buffers = 64; // buffers per vectored send
+};
+
+struct TcpWriteQueueStats {
+  std::uint64_t sends = 0;
+  std::uint64_t buffers = 0;
+  std::uint64_t bytes = 0;
+  std::uint64_t blocked = 0; // writes that waited for the queue to drain
+};
+
+struct TcpWriteQueueWriteResult {
+  bool finished = false;
+  bool success = false;
+};
+
+// queues an owned buffer, only suspends while the queue is above the high water mark
+struct TcpWriteQueueWrite {
+public:
+  TcpWriteQueue &queue;
+  bool *is_waiting = nullptr;
+
+  bool finished = false;
+  bool success = false;
+
+public:
+  inline TcpWriteQueueWrite(TcpWriteQueue *queue, std::string buf);
+  inline TcpWriteQueueWrite(const TcpWriteQueueWrite &other) = delete;
+
+public:
+  inline auto io_drained(bool success) -> void {
+    if (is_waiting != nullptr) {
+      *is_waiting = false;
+    }
+    finished = true;
+    this->success = success;
+  }
+
+public:
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return finished;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    this->is_waiting = &cohandle.promise().is_waiting;
+    *this->is_waiting = true;
+  }
+
+  inline auto await_resume() -> TcpWriteQueueWriteResult {
+    return {
+      .finished = finished,
+      .success = success,
+    };
+  }
+};
+
+// outbound queue of a socket: buffers queued between two sends are coalesced into one vectored send
+struct TcpWriteQueue {
+public:
+  TaskScheduler &ts;
+  TcpSocket &tcp_socket;
+  TcpWriteQueueOptions options;
+  TcpWriteQueueStats stats;
+
+  bool success = true;
+  bool closing = false;
+  bool closed = false;
+  bool *writer_is_waiting = nullptr;
+  bool *close_is_waiting = nullptr;
+
+  std::deque<std::string> queued;
+  std::size_t queued_bytes = 0;
+  std::vector<TcpWriteQueueWrite *> blocked_writes;
+
+public:
+  inline TcpWriteQueue(TcpSocket *sock, TcpWriteQueueOptions options = {})
+      : ts{sock->ts}, tcp_socket{*sock}, options{options} {
+    if (this->options.low_water > this->options.high_water) {
+      this->options.low_water = this->options.high_water;
+    }
+    if (this->options.max_batch_buffers == 0) {
+      this->options.max_batch_buffers = 1;
+    }
+    ts.schedule_detached(run(ts, this));
+  }
+
+  inline TcpWriteQueue(const TcpWriteQueue &other) = delete;
+
+  inline ~TcpWriteQueue() {
+    assert(closed and "TcpWriteQueue must be closed (co_await queue.close()) before it is destroyed");
+  }
+
+public:
+  // must be awaited, suspends only while the queue is above the high water mark
+  [[nodiscard]] inline auto write(std::string buf) -> TcpWriteQueueWrite {
+    return {this, std::move(buf)};
+  }
+
+  // queues without waiting (ignores the high water mark), false once the queue is closing or failed
+  inline auto push(std::string buf) -> bool {
+    if (closing or not success) {
+      return false;
+    }
+    if (buf.empty()) {
+      return true;
+    }
+    queued_bytes += buf.size();
+    queued.push_back(std::move(buf));
+    wake_writer();
+    return true;
+  }
+
+  // flushes what is queued, must be awaited before the queue is destroyed
+  inline auto close() -> TcpWriteQueueClose;
+
+  inline auto wake_writer() -> void {
+    if (writer_is_waiting != nullptr) {
+      *writer_is_waiting = false;
+    }
+  }
+
+  inline auto wake_blocked(bool success) -> void {
+    for (const auto write : blocked_writes) {
+      write->io_drained(success);
+    }
+    blocked_writes.clear();
+  }
+
+private:
+  static inline auto run(TaskScheduler &ts, TcpWriteQueue *queue) -> Task<void>;
+};
+
+inline TcpWriteQueueWrite::TcpWriteQueueWrite(TcpWriteQueue *queue, std::string buf) : queue{*queue} {
+  if (not queue->push(std::move(buf))) {
+    finished = true;
+    success = false;
+    return;
+  }
+
+  if (queue->queued_bytes <= queue->options.high_water) {
+    finished = true;
+    success = true;
+    return;
+  }
+
+  queue->stats.blocked += 1;
+  queue->blocked_writes.push_back(this);
+}
+
+// suspends the queue writer until there is something to send
+struct TcpWriteQueueIdle {
+  TcpWriteQueue &queue;
+
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return not queue.queued.empty() or queue.closing;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    queue.writer_is_waiting = &cohandle.promise().is_waiting;
+    *queue.writer_is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    queue.writer_is_waiting = &cohandle.promise().is_waiting;
+    *queue.writer_is_waiting = true;
+  }
+
+  inline auto await_resume() const noexcept -> void {
+    queue.writer_is_waiting = nullptr;
+  }
+};
+
+// resumes once every queued buffer is sent (or the queue failed)
+struct TcpWriteQueueClose {
+  TcpWriteQueue &queue;
+
+  [[nodiscard]] inline auto await_ready() const -> bool {
+    return queue.closed;
+  }
+
+  template <typename TaskResult, typename Promise = Task<TaskResult>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    queue.close_is_waiting = &cohandle.promise().is_waiting;
+    *queue.close_is_waiting = true;
+  }
+
+  template <typename Promise = Task<void>::promise_type>
+  inline auto await_suspend(std::coroutine_handle<Promise> cohandle) noexcept -> void {
+    queue.close_is_waiting = &cohandle.promise().is_waiting;
+    *queue.close_is_waiting = true;
+  }
+
+  inline auto await_resume() const noexcept -> void {}
+};
+
+inline auto TcpWriteQueue::close() -> TcpWriteQueueClose {
+  closing = true;
+  wake_writer();
+  return {*this};
+}
+
+inline auto TcpWriteQueue::run(TaskScheduler &, TcpWriteQueue *queue) -> Task<void> {
+  auto batch = std::vector<std::string>{};
+  auto batch_bufs = std::vector<std::span<const char>>{};
+
+  while (queue->success) {
+    if (queue->queued.empty()) {
+      if (queue->closing) {
+        break;
+      }
+      co_await TcpWriteQueueIdle{*queue};
+      continue;
+    }
+
+    // take everything queued since the last send (up to max_batch_buffers)
+    batch.clear();
+    batch_bufs.clear();
+    auto batch_bytes = std::size_t{0};
+    while (not queue->queued.empty() and batch.size() < queue->options.max_batch_buffers) {
+      batch_bytes += queue->queued.front().size();
+      batch.push_back(std::move(queue->queued.front()));
+      queue->queued.pop_front();
+    }
+    for (const auto &buf : batch) {
+      batch_bufs.emplace_back(buf.data(), buf.size());
+    }
+
+    // one vectored send for the whole batch
+    auto send_result = co_await TcpSendAllV{&queue->tcp_socket, batch_bufs};
+    queue->queued_bytes -= batch_bytes;
+    queue->success = send_result.success;
+    queue->stats.sends += 1;
+    queue->stats.buffers += batch.size();
+    queue->stats.bytes += send_result.bytes_sent;
+
+    if (queue->queued_bytes <= queue->options.low_water) {
+      queue->wake_blocked(queue->success);
+    }
+  }
+
+  // failed: drop what is left
+  queue->queued.clear();
+  queue->queued_bytes = 0;
+  queue->wake_blocked(queue->success);
+
+  queue->closed = true;
+  if (queue->close_is_waiting != nullptr) {
+    *queue->close_is_waiting = false;
+  }
+}
+
+} // namespace cotask